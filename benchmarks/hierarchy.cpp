@@ -0,0 +1,128 @@
+// HierarchySystem frame cost on a deep scene (chains of 1000 levels) and a
+// wide one (100k roots), when everything moves, when only the roots move and
+// when nothing does. Also times re-parenting a subtree, alone and with the
+// frame that follows it, and destroying 1000 child entities. Root subtrees
+// are updated on the job system.
+//
+//   make benchmarks && ./build/benchmarks/hierarchy
+#include <engine/core/jobSystem.hpp>
+#include <engine/core/world.hpp>
+#include <engine/systems/systems.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace engine;
+using Clock = std::chrono::steady_clock;
+
+template <typename Fn> static double bestMs(Fn &&fn) {
+  double best = 1e30;
+  for (int i = 0; i < 10; ++i) {
+    auto start = Clock::now();
+    fn();
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+// chains roots of depth levels each
+static void run(const char *name, std::size_t chains, std::size_t depth,
+                EngineContext &context) {
+  World world;
+  world.setContext(&context);
+  world.addSystem(std::make_shared<HierarchySystem>());
+
+  std::vector<Entity> roots;
+  for (std::size_t c = 0; c < chains; ++c) {
+    Entity parent = NullEntity;
+    for (std::size_t d = 0; d < depth; ++d) {
+      Entity e = world.createEntity();
+      TransformComponent transform;
+      transform.position = Vec3(0.1f, 0.2f, 0.3f);
+      transform.setEuler(Vec3(0.01f, 0.02f, 0.03f));
+      world.addComponent(e, transform);
+      if (parent != NullEntity)
+        world.setParent(e, parent);
+      else
+        roots.push_back(e);
+      parent = e;
+    }
+  }
+  world.updateSystems(0.f);
+
+  double all = bestMs([&] {
+    for (auto [e, transform] : world.view<TransformComponent>())
+      transform.position.x += 0.001f;
+    world.updateSystems(0.f);
+  });
+  double rootsOnly = bestMs([&] {
+    for (Entity root : roots)
+      world.getComponent<TransformComponent>(root).position.x += 0.001f;
+    world.updateSystems(0.f);
+  });
+  double idle = bestMs([&] { world.updateSystems(0.f); });
+
+  // moves the lower half of the first chain, or the first root, back and
+  // forth
+  Entity moving = world.getHierarchy().entityAt(
+      static_cast<uint32_t>(depth / 2));
+  Entity above = depth > 1
+                     ? world.getComponent<const ParentComponent>(moving).parent
+                     : NullEntity;
+  double reparent = bestMs([&] {
+    world.setParent(moving, roots.back());
+    if (above != NullEntity)
+      world.setParent(moving, above);
+    else
+      world.removeParent(moving);
+  });
+  // setParent only relinks, the next frame restores the node order
+  double reparentFrame = bestMs([&] {
+    world.setParent(moving, roots.back());
+    world.updateSystems(0.f);
+    if (above != NullEntity)
+      world.setParent(moving, above);
+    else
+      world.removeParent(moving);
+    world.updateSystems(0.f);
+  });
+
+  // spawning isn't timed, only the destroys and the frame after them
+  double despawn = 1e30;
+  for (int i = 0; i < 10; ++i) {
+    std::vector<Entity> spawned;
+    for (std::size_t j = 0; j < 1000; ++j) {
+      Entity e = world.createEntity();
+      world.addComponent(e, TransformComponent{});
+      world.setParent(e, roots[j % roots.size()]);
+      spawned.push_back(e);
+    }
+    world.updateSystems(0.f);
+
+    auto start = Clock::now();
+    for (Entity e : spawned)
+      world.destroyEntity(e);
+    world.updateSystems(0.f);
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    despawn = std::min(despawn, elapsed.count());
+  }
+
+  std::printf("%-6s %7zu nodes   all moving %8.3f ms   roots moving %8.3f ms"
+              "   static %8.3f ms   setParent %8.4f ms   setParent+frame %8.3f ms"
+              "   despawn 1k %8.3f ms\n",
+              name, chains * depth, all, rootsOnly, idle, reparent / 2,
+              reparentFrame / 2, despawn);
+}
+
+int main() {
+  JobSystem jobs;
+  EngineContext context;
+  context.jobs = &jobs;
+
+  std::printf("threads: %u\n", jobs.threadCount());
+  run("deep", 100, 1000, context);
+  run("wide", 100000, 1, context);
+}
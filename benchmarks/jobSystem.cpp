@@ -0,0 +1,80 @@
+// Scheduling overhead of the job system: time per empty job when submitted
+// one by one, chained, and split by parallelFor.
+//
+//   make benchmarks && ./build/benchmarks/jobSystem [jobs]
+#include <engine/core/jobSystem.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace engine;
+using Clock = std::chrono::steady_clock;
+
+template <typename Fn> static double nsPerJob(std::size_t jobs, Fn &&fn) {
+  fn(); // warm up queues and threads
+  auto start = Clock::now();
+  fn();
+  std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+  return elapsed.count() / jobs;
+}
+
+int main(int argc, char **argv) {
+  std::size_t jobs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+  JobSystem system;
+  std::atomic<std::size_t> sink{0};
+
+  std::printf("threads: %u, jobs: %zu\n", system.threadCount(), jobs);
+
+  double run = nsPerJob(jobs, [&] {
+    JobSystem::Counter counter;
+    for (std::size_t i = 0; i < jobs; ++i)
+      system.run([&sink] { sink.fetch_add(1, std::memory_order_relaxed); },
+                 &counter);
+    system.wait(counter);
+  });
+  std::printf("run + wait:         %8.1f ns/job\n", run);
+
+  std::size_t length = jobs / 10;
+  double chained = nsPerJob(length, [&] {
+    std::vector<JobSystem::Counter> counters(length);
+    system.run([&sink] { sink.fetch_add(1, std::memory_order_relaxed); },
+               &counters[0]);
+    for (std::size_t i = 1; i < length; ++i)
+      system.runAfter(
+          counters[i - 1],
+          [&sink] { sink.fetch_add(1, std::memory_order_relaxed); },
+          &counters[i]);
+    for (auto &counter : counters)
+      system.wait(counter);
+  });
+  std::printf("runAfter chain:     %8.1f ns/job\n", chained);
+
+  // Without workers parallelFor calls the body once, inline
+  if (system.threadCount() == 1) {
+    std::printf("parallelFor grain 1:      n/a (no workers)\n");
+    std::printf("parallelFor auto:         n/a (no workers)\n");
+    return sink.load() == 0;
+  }
+
+  double ranges = nsPerJob(jobs, [&] {
+    system.parallelFor(
+        0, jobs,
+        [&sink](std::size_t begin, std::size_t end) {
+          sink.fetch_add(end - begin, std::memory_order_relaxed);
+        },
+        1);
+  });
+  std::printf("parallelFor grain 1:%8.1f ns/index\n", ranges);
+
+  double adaptive = nsPerJob(jobs, [&] {
+    system.parallelFor(0, jobs, [&sink](std::size_t begin, std::size_t end) {
+      sink.fetch_add(end - begin, std::memory_order_relaxed);
+    });
+  });
+  std::printf("parallelFor auto:   %8.1f ns/index\n", adaptive);
+
+  return sink.load() == 0;
+}
@@ -0,0 +1,103 @@
+// Mat4 products with the inline SIMD math against the previous out-of-line
+// scalar code (reproduced below), and a check that both give the same
+// floats. Build with CXXFLAGS+=-mavx2 to try the AVX path.
+//
+//   make benchmarks && ./build/benchmarks/math [count]
+#include <engine/math/mat4.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace engine;
+using Clock = std::chrono::steady_clock;
+
+// The old implementation: row/column Vec4 temporaries and dot products
+namespace reference {
+__attribute__((noinline)) float dot(const Vec4 &a, const Vec4 &b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+__attribute__((noinline)) Vec4 row(const Mat4 &m, int r) {
+  return Vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+}
+__attribute__((noinline)) Vec4 col(const Mat4 &m, int c) {
+  return Vec4(m[c][0], m[c][1], m[c][2], m[c][3]);
+}
+__attribute__((noinline)) Mat4 multiply(const Mat4 &a, const Mat4 &b) {
+  Mat4 nm{};
+  for (int c = 0; c < 4; c++) {
+    Vec4 column = col(b, c);
+    for (int r = 0; r < 4; r++)
+      nm[c][r] = dot(row(a, r), column);
+  }
+  return nm;
+}
+__attribute__((noinline)) Vec4 multiply(const Mat4 &a, const Vec4 &v) {
+  Vec4 result{};
+  for (int r = 0; r < 4; r++)
+    result[r] = dot(row(a, r), v);
+  return result;
+}
+} // namespace reference
+
+template <typename Fn> static double bestMs(Fn &&fn) {
+  double best = 1e30;
+  for (int i = 0; i < 10; ++i) {
+    auto start = Clock::now();
+    fn();
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+#if defined(ENGINE_MATH_AVX)
+  const char *backend = "avx";
+#elif defined(ENGINE_MATH_SSE)
+  const char *backend = "sse";
+#else
+  const char *backend = "scalar";
+#endif
+
+  std::vector<Mat4> a(count), b(count), out(count), expected(count);
+  std::vector<Vec4> v(count), vout(count), vexpected(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    a[i] = Mat4::trs(Vec3(i * 0.1f, 2, 3), Quat::fromEuler(Vec3(0.1f * i, 1, 2)),
+                     Vec3(1.5f));
+    b[i] = Mat4::perspective(1.2f, 1.7f, 0.1f, 100.f + i) * a[i];
+    v[i] = Vec4(i * 0.5f, -1.f, 3.f, 1.f);
+  }
+
+  double refMat = bestMs([&] {
+    for (std::size_t i = 0; i < count; ++i)
+      expected[i] = reference::multiply(a[i], b[i]);
+  });
+  double newMat = bestMs([&] {
+    for (std::size_t i = 0; i < count; ++i)
+      out[i] = a[i] * b[i];
+  });
+  double refVec = bestMs([&] {
+    for (std::size_t i = 0; i < count; ++i)
+      vexpected[i] = reference::multiply(a[i], v[i]);
+  });
+  double newVec = bestMs([&] {
+    for (std::size_t i = 0; i < count; ++i)
+      vout[i] = a[i] * v[i];
+  });
+
+  bool same =
+      std::memcmp(out.data(), expected.data(), count * sizeof(Mat4)) == 0 &&
+      std::memcmp(vout.data(), vexpected.data(), count * sizeof(Vec4)) == 0;
+
+  std::printf("backend: %s, count: %zu, bit-identical: %s\n", backend, count,
+              same ? "yes" : "NO");
+  std::printf("Mat4 * Mat4  old %7.3f ms   new %7.3f ms   %.1fx\n", refMat,
+              newMat, refMat / newMat);
+  std::printf("Mat4 * Vec4  old %7.3f ms   new %7.3f ms   %.1fx\n", refVec,
+              newVec, refVec / newVec);
+  return same ? 0 : 1;
+}
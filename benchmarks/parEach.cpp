@@ -0,0 +1,67 @@
+// Serial View::each against View::parEach on a movement integrator, in both
+// storage modes.
+//
+//   make benchmarks && ./build/benchmarks/parEach [entities]
+#include <engine/core/jobSystem.hpp>
+#include <engine/core/world.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace engine;
+using Clock = std::chrono::steady_clock;
+
+struct Position {
+  float x = 0, y = 0, z = 0;
+};
+struct Velocity {
+  float x = 1, y = 2, z = 3;
+};
+
+template <typename Fn> static double bestMs(Fn &&fn) {
+  double best = 1e30;
+  for (int i = 0; i < 10; ++i) {
+    auto start = Clock::now();
+    fn();
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+static void run(StorageMode mode, const char *name, std::size_t entities,
+                EngineContext &context) {
+  World world(mode);
+  world.setContext(&context);
+  for (std::size_t i = 0; i < entities; ++i) {
+    Entity e = world.createEntity();
+    world.addComponent(e, Position{});
+    world.addComponent(e, Velocity{});
+  }
+
+  const float dt = 1.0f / 60.0f;
+  auto integrate = [dt](Position &p, const Velocity &v) {
+    p.x += v.x * dt;
+    p.y += v.y * dt;
+    p.z += v.z * dt;
+  };
+  double serial = bestMs(
+      [&] { world.view<Position, const Velocity>().each(integrate); });
+  double parallel = bestMs(
+      [&] { world.view<Position, const Velocity>().parEach(integrate); });
+  std::printf("%-10s each %7.2f ms   parEach %7.2f ms   speedup %.2fx\n",
+              name, serial, parallel, serial / parallel);
+}
+
+int main(int argc, char **argv) {
+  std::size_t entities =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500000;
+  JobSystem jobs;
+  EngineContext context;
+  context.jobs = &jobs;
+
+  std::printf("threads: %u, entities: %zu\n", jobs.threadCount(), entities);
+  run(StorageMode::SparseSet, "sparse", entities, context);
+  run(StorageMode::Archetype, "archetype", entities, context);
+}
@@ -0,0 +1,119 @@
+// Software rasterizer frame cost: a few large on-screen triangles (a floor
+// and walls close to the camera), many small ones (a dense sphere), and a
+// stack of walls hiding each other, drawn in both orders.
+// Each scene is drawn with the tiles rasterized on the calling thread, on the
+// job system, and on the job system with visibility buffer shading. Uses SDL's dummy video driver, nothing is shown.
+//
+//   make benchmarks && ./build/benchmarks/raster
+#include <engine/core/jobSystem.hpp>
+#include <engine/core/world.hpp>
+#include <engine/renderer/renderer.hpp>
+#include <engine/systems/systems.hpp>
+
+#include <SDL2/SDL.h>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+using namespace engine;
+using Clock = std::chrono::steady_clock;
+
+static const int Width = 1280, Height = 720;
+
+template <typename Fn> static double bestMs(Fn &&fn) {
+  double best = 1e30;
+  for (int i = 0; i < 10; ++i) {
+    auto start = Clock::now();
+    fn();
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+static void add(World &world, std::shared_ptr<Mesh> mesh, Vec3 position,
+                Vec3 euler, Vec3 color) {
+  Entity e = world.createEntity();
+  TransformComponent transform;
+  transform.position = position;
+  transform.setEuler(euler);
+  world.addComponent(e, transform);
+  world.addComponent(e, MeshComponent{mesh});
+  MaterialComponent material;
+  material.baseColor = color;
+  world.addComponent(e, material);
+}
+
+static void run(const char *name, Renderer &renderer,
+                void (*setup)(World &world), EngineContext &context) {
+  World world;
+  world.setContext(&context);
+  world.addSystem(std::make_shared<HierarchySystem>());
+  world.addSystem(std::make_shared<RenderSystem>(&renderer));
+
+  Entity camera = world.createEntity();
+  TransformComponent transform;
+  transform.position = Vec3(0, 0, -5);
+  world.addComponent(camera, transform);
+  world.addComponent(camera, CameraComponent{float(M_PI / 2),
+                                             float(Width) / Height, 1.0f,
+                                             60.f});
+  world.setCameraEntity(camera);
+  setup(world);
+
+  auto frame = [&] {
+    renderer.clear();
+    world.updateSystems(0.f);
+  };
+  JobSystem *jobs = context.jobs;
+  context.jobs = nullptr;
+  double serial = bestMs(frame);
+  context.jobs = jobs;
+  double parallel = bestMs(frame);
+  renderer.setShadingMode(ShadingMode::Visibility);
+  double visibility = bestMs(frame);
+  renderer.setShadingMode(ShadingMode::Forward);
+  std::printf("%-8s serial %8.3f ms  jobs %8.3f ms  visibility %8.3f ms per "
+              "frame\n",
+              name, serial, parallel, visibility);
+}
+
+int main() {
+  SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+  SDL_Init(SDL_INIT_VIDEO);
+  {
+    Renderer renderer(Width, Height, "raster");
+    JobSystem jobs;
+    EngineContext context;
+    context.jobs = &jobs;
+    std::printf("threads: %u\n", jobs.threadCount());
+
+    run("large", renderer, [](World &world) {
+      add(world, Mesh::createBox(60, 0.2f, 60), Vec3(0, -2.5f, 0), Vec3(0),
+          Vec3(0.6f, 0.6f, 0.5f));
+      add(world, Mesh::createBox(8, 8, 0.5f), Vec3(0, 0, 3),
+          Vec3(0, 0.2f, 0), Vec3(0.3f, 0.4f, 1));
+      add(world, Mesh::createBox(0.5f, 8, 20), Vec3(-4, 0, 6), Vec3(0),
+          Vec3(1, 0.5f, 0.2f));
+    }, context);
+    // stacked walls hiding each other; the render view visits entities
+    // newest first, so the nearest wall is drawn first
+    run("overdraw", renderer, [](World &world) {
+      for (int i = 0; i < 16; ++i)
+        add(world, Mesh::createBox(12, 8, 0.2f), Vec3(0, 0, 8.5f - i * 0.5f),
+            Vec3(0), Vec3(0.2f + i * 0.05f, 0.4f, 0.6f));
+    }, context);
+    // the same walls drawn farthest first, every one passes the depth test
+    run("reversed", renderer, [](World &world) {
+      for (int i = 0; i < 16; ++i)
+        add(world, Mesh::createBox(12, 8, 0.2f), Vec3(0, 0, 1.0f + i * 0.5f),
+            Vec3(0), Vec3(0.95f - i * 0.05f, 0.4f, 0.6f));
+    }, context);
+    run("dense", renderer, [](World &world) {
+      add(world, Mesh::createSphere(2.5f, 256, 256), Vec3(0, 0, 0),
+          Vec3(0.3f, 0.5f, 0), Vec3(0.2f, 0.8f, 0.3f));
+    }, context);
+  }
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,85 @@
+// Sparse-set against archetype storage at 10k, 100k and 1M entities:
+// iterating the renderer's Transform + GlobalTransform + Mesh + Material
+// query, adding and removing a component on every entity, and creating and
+// destroying them all.
+//
+//   make benchmarks && ./build/benchmarks/storage
+#include <engine/core/world.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace engine;
+using Clock = std::chrono::steady_clock;
+
+struct Velocity {
+  float x = 1, y = 2, z = 3;
+};
+
+template <typename Fn> static double bestMs(Fn &&fn) {
+  double best = 1e30;
+  for (int i = 0; i < 10; ++i) {
+    auto start = Clock::now();
+    fn();
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+static void spawn(World &world, std::vector<Entity> &entities,
+                  std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    Entity e = world.createEntity();
+    TransformComponent transform;
+    transform.position = Vec3(float(i % 100), float(i / 100 % 100), 0.f);
+    world.addComponent(e, transform);
+    world.addComponent(e, MeshComponent{});
+    world.addComponent(e, MaterialComponent{});
+    entities.push_back(e);
+  }
+}
+
+static void run(StorageMode mode, const char *name, std::size_t count) {
+  World world(mode);
+  std::vector<Entity> entities;
+  spawn(world, entities, count);
+
+  double iterate = bestMs([&] {
+    world
+        .view<TransformComponent, GlobalTransform, MeshComponent,
+              MaterialComponent>()
+        .each([](TransformComponent &transform, GlobalTransform &global,
+                 MeshComponent &, MaterialComponent &) {
+          global.set(Mat4::modelMatrix(transform));
+        });
+  });
+
+  double addRemove = bestMs([&] {
+    for (Entity e : entities)
+      world.addComponent(e, Velocity{});
+    for (Entity e : entities)
+      world.removeComponent<Velocity>(e);
+  });
+
+  // destroys the entities and spawns them again, a second set of 1M
+  // wouldn't fit in an entity index
+  double createDestroy = bestMs([&] {
+    for (Entity e : entities)
+      world.destroyEntity(e);
+    entities.clear();
+    spawn(world, entities, count);
+  });
+
+  std::printf("%-10s %8zu   iterate %8.2f ms   add+remove %8.2f ms"
+              "   create+destroy %8.2f ms\n",
+              name, count, iterate, addRemove, createDestroy);
+}
+
+int main() {
+  for (std::size_t count : {10000, 100000, 1000000}) {
+    run(StorageMode::SparseSet, "sparse", count);
+    run(StorageMode::Archetype, "archetype", count);
+  }
+}
@@ -0,0 +1,107 @@
+// Vertex stage of a mesh: the renderer's old per-triangle path (the full
+// projection chain and perspective divide for each of the three corners)
+// against one transformPositions + projectToScreen pass per mesh, plus a
+// check that both give the same floats. Build with CXXFLAGS+=-mavx2 to try
+// the AVX path.
+//
+//   make benchmarks && ./build/benchmarks/vertexBatch [segments]
+#include <engine/assets/mesh.hpp>
+#include <engine/math/vertexBatch.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace engine;
+using Clock = std::chrono::steady_clock;
+
+template <typename Fn> static double bestMs(Fn &&fn) {
+  double best = 1e30;
+  for (int i = 0; i < 10; ++i) {
+    auto start = Clock::now();
+    fn();
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  int segments = argc > 1 ? std::atoi(argv[1]) : 256;
+  auto mesh = Mesh::createSphere(4.0f, segments, segments);
+  std::size_t count = mesh->vertices.size();
+
+  Mat4 model = Mat4::trs(Vec3(0.5f, -1, -8), Quat::fromEuler(Vec3(0.3f, 1, 0)),
+                         Vec3(1.5f));
+  Mat4 view = Mat4::identity();
+  Mat4 persp = Mat4::perspective(1.2f, 16.f / 9.f, 0.1f, 100.f);
+
+  const float width = 1600, height = 900;
+  auto toScreen = [&](const Vec4 &c) {
+    if (c.w <= 0.0f)
+      return Vec3(-1, -1, -1);
+    Vec3 pr = c.toVec3();
+    return Vec3(width * (pr.x + 1) / 2, height * (1 - pr.y) / 2, pr.z);
+  };
+
+  // corners kept inside the frustum and their x summed, so the loops can't
+  // be optimized away
+  std::size_t inside = 0;
+  float sum = 0;
+  double perCorner = bestMs([&] {
+    inside = 0;
+    sum = 0;
+    for (const Triangle &tri : mesh->triangles) {
+      for (int i : {tri.i0, tri.i1, tri.i2}) {
+        const Vec3 &v = mesh->vertices[i];
+        Vec4 c = persp * view * model * Vec4(v.x, v.y, v.z, 1);
+        bool in = -c.w <= c.x && c.x <= c.w && -c.w <= c.y && c.y <= c.w &&
+                  -c.w <= c.z && c.z <= c.w;
+        inside += in;
+        if (in)
+          sum += toScreen(c).x;
+      }
+    }
+  });
+
+  math::ClipVertices clip;
+  math::ScreenVertices screen;
+  std::size_t batchedInside = 0;
+  float batchedSum = 0;
+  double batched = bestMs([&] {
+    Mat4 mvp = persp * view * model;
+    clip.resize(count);
+    screen.resize(count);
+    math::transformPositions(mvp, mesh->xs.data(), mesh->ys.data(),
+                             mesh->zs.data(), count, clip);
+    math::projectToScreen(clip, width, height, screen);
+    batchedInside = 0;
+    batchedSum = 0;
+    for (const Triangle &tri : mesh->triangles) {
+      for (int i : {tri.i0, tri.i1, tri.i2}) {
+        bool in = clip.outcodes[i] == 0;
+        batchedInside += in;
+        if (in)
+          batchedSum += screen.x[i];
+      }
+    }
+  });
+
+  Mat4 mvp = persp * view * model;
+  bool same = inside == batchedInside && sum == batchedSum;
+  for (std::size_t i = 0; i < count; ++i) {
+    const Vec3 &v = mesh->vertices[i];
+    Vec4 e = mvp * Vec4(v.x, v.y, v.z, 1);
+    Vec3 p = toScreen(e);
+    same = same && e.x == clip.x[i] && e.y == clip.y[i] && e.z == clip.z[i] &&
+           e.w == clip.w[i] && p.x == screen.x[i] && p.y == screen.y[i] &&
+           p.z == screen.z[i];
+  }
+
+  std::printf("vertices: %zu, triangles: %zu, bit-identical: %s\n", count,
+              mesh->triangles.size(), same ? "yes" : "NO");
+  std::printf("per corner %7.3f ms   batched %7.3f ms   %.1fx\n", perCorner,
+              batched, perCorner / batched);
+  return same ? 0 : 1;
+}
@@ -22,6 +22,23 @@ struct Mesh {
   Vec3 size{1};
   Vec3 sphereData{1.0, 16.0, 32.0};
 
+  // Optional SoA mirror of vertices for the batched vertex transform. The
+  // loaders fill it; call updateSoA() after editing vertices, or clear it.
+  std::vector<float> xs, ys, zs;
+  void updateSoA();
+  bool hasSoA() const { return xs.size() == vertices.size(); }
+
+  // Bounding sphere of vertices in mesh space, a negative radius means
+  // unknown and the mesh is never culled. The loaders fill it.
+  Vec3 boundsCenter{0};
+  float boundsRadius = -1.0f;
+  void updateBounds();
+
+  // Per-vertex normals for smooth shading, the area weighted average of the
+  // adjacent faces' normals. The loaders fill it.
+  std::vector<Vec3> normals;
+  void updateNormals();
+
   static std::shared_ptr<Mesh> createBox(float width, float height, float depth);
   static std::shared_ptr<Mesh> createSphere(float radius, int latSegments, int lonSegments);
   static std::shared_ptr<Mesh> loadFromObj(const std::string &filename);
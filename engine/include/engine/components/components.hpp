@@ -3,7 +3,10 @@
 #include "engine/assets/texture.hpp"
 
 #include "engine/math/mat4.hpp"
+#include "engine/math/mat4x3.hpp"
+#include "engine/math/quat.hpp"
 #include "engine/math/vec3.hpp"
+#include <atomic>
 #include <memory>
    
 namespace engine {
@@ -13,12 +16,42 @@ using ScriptPtr = std::shared_ptr<Script>;
 using Entity = uint32_t;
 struct TransformComponent {
   Vec3 position = {0, 0, 0};
-  Vec3 rotation = {0, 0, 0};
+  Quat rotation;
   Vec3 scale = {1.0f, 1.0f, 1.0f};
+
+  // Euler angles in radians, applied X, then Y, then Z
+  Vec3 getEuler() const { return rotation.toEuler(); }
+  void setEuler(const Vec3 &euler) { rotation = Quat::fromEuler(euler); }
 };
 
 struct GlobalTransform {
   Mat4 worldMatrix{};
+
+  GlobalTransform() = default;
+  GlobalTransform(const Mat4 &world) : worldMatrix(world) {}
+  GlobalTransform(const GlobalTransform &other)
+      : worldMatrix(other.worldMatrix) {}
+  GlobalTransform(GlobalTransform &&other) noexcept;
+  GlobalTransform &operator=(const GlobalTransform &other);
+  GlobalTransform &operator=(GlobalTransform &&other) noexcept;
+  ~GlobalTransform();
+
+  // Assigns worldMatrix and drops the cached matrices below. Call
+  // invalidate() after writing worldMatrix directly.
+  void set(const Mat4 &world);
+  void invalidate();
+
+  // Inverse of worldMatrix (taken as affine) and the inverse-transpose of its
+  // linear part for normals. Both are computed together on first use and
+  // kept until the next set(), entities nobody asks about never allocate
+  // them. Safe to call from several readers at once.
+  const Mat4x3 &inverse() const;
+  const Mat4x3 &normalMatrix() const;
+
+private:
+  struct Cache;
+  const Cache &cached() const;
+  mutable std::atomic<Cache *> cache{nullptr};
 };
 
 struct CameraComponent {
@@ -48,6 +81,12 @@ struct MaterialComponent {
   std::shared_ptr<Texture> texture;
 
   bool useTexture = false;
+  // Interpolate the mesh's vertex normals across triangles instead of
+  // lighting each triangle with its face normal
+  bool smoothShading = false;
+  // When off, pixels are drawn over whatever is there and leave the depth
+  // buffer as it is
+  bool depthTest = true;
 };
 
 struct ScriptComponent {
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace engine {
+
+// Work-stealing job system. Every worker owns a deque: it pushes and pops its
+// own jobs at the back while idle workers steal from the front. Jobs posted
+// from threads outside the pool go to a shared queue. Waiting on a counter
+// runs other jobs instead of blocking, so jobs may wait on jobs they spawn.
+// Jobs must not throw.
+class JobSystem {
+public:
+  class Counter;
+
+private:
+  struct Job {
+    void (*fn)(void *data, std::size_t begin, std::size_t end);
+    void *data;
+    std::size_t begin;
+    std::size_t end;
+    Counter *counter;
+  };
+
+public:
+  // Number of unfinished jobs attached to it. Must outlive them: wait() on a
+  // counter before destroying it.
+  class Counter {
+  public:
+    bool done() const { return pending.load() == 0 && finishing.load() == 0; }
+
+  private:
+    friend class JobSystem;
+    std::atomic<std::size_t> pending{0};
+    // jobs between their last access to the counter and returning
+    std::atomic<std::size_t> finishing{0};
+    std::mutex mutex;
+    // queued once pending reaches zero
+    std::vector<Job> continuations;
+  };
+
+  // 0 starts one worker per hardware thread besides the caller
+  explicit JobSystem(unsigned workers = 0);
+  ~JobSystem();
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  void run(std::function<void()> job, Counter *counter = nullptr);
+  // Queues job once dependency reaches zero
+  void runAfter(Counter &dependency, std::function<void()> job,
+                Counter *counter = nullptr);
+  // Runs queued jobs until counter reaches zero
+  void wait(Counter &counter);
+
+  // Calls body(rangeBegin, rangeEnd) over [begin, end) in ranges of up to
+  // grain indices, each starting at begin plus a multiple of grain (0 picks
+  // about sixteen per thread), and returns when all are done. The calling
+  // thread starts with all of it and hands half of what it has left to the
+  // pool whenever the queues run dry, as does every thread taking such a
+  // half, so uneven ranges balance out.
+  template <typename Body>
+  void parallelFor(std::size_t begin, std::size_t end, Body &&body,
+                   std::size_t grain = 0);
+
+  // Workers plus the calling thread
+  unsigned threadCount() const {
+    return static_cast<unsigned>(workers.size()) + 1;
+  }
+  // 1..workers on worker threads of any JobSystem, 0 elsewhere. Handy for
+  // indexing per-thread scratch data of size threadCount().
+  static unsigned threadIndex();
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+  // submit() counts the job on its counter, push() only queues it
+  void submit(const Job &job);
+  void push(const Job &job);
+  bool next(Job &job);
+  void execute(const Job &job);
+  void finish(Counter &counter);
+  void loop(unsigned index);
+  // index of this thread's queue
+  std::size_t self() const;
+
+  // Shared by the jobs of one parallelFor
+  template <typename Fn> struct Split {
+    JobSystem *jobs;
+    Fn *body;
+    std::size_t grain;
+    Counter *counter;
+  };
+  template <typename Fn>
+  static void runSplit(void *split, std::size_t begin, std::size_t end);
+
+  // queues[0] takes jobs from outside threads, queues[i] belongs to worker i
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  std::atomic<std::size_t> queued{0};
+  std::atomic<unsigned> sleepers{0};
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+  bool stopping = false;
+};
+
+template <typename Body>
+void JobSystem::parallelFor(std::size_t begin, std::size_t end, Body &&body,
+                            std::size_t grain) {
+  if (begin >= end)
+    return;
+  std::size_t count = end - begin;
+  if (grain == 0)
+    grain = std::max<std::size_t>(1, count / (threadCount() * 16));
+  if (count <= grain || workers.empty()) {
+    body(begin, end);
+    return;
+  }
+
+  using Fn = std::remove_reference_t<Body>;
+  Counter counter;
+  Split<Fn> split{this, &body, grain, &counter};
+  runSplit<Fn>(&split, begin, end);
+  wait(counter);
+}
+
+template <typename Fn>
+void JobSystem::runSplit(void *data, std::size_t begin, std::size_t end) {
+  const Split<Fn> &split = *static_cast<Split<Fn> *>(data);
+  while (begin < end) {
+    // Idle threads steal the oldest, so the largest, halves first
+    std::size_t ranges = (end - begin + split.grain - 1) / split.grain;
+    if (ranges > 1 && split.jobs->queued.load() == 0) {
+      std::size_t middle = begin + ranges / 2 * split.grain;
+      split.jobs->submit({&runSplit<Fn>, data, middle, end, split.counter});
+      end = middle;
+      continue;
+    }
+    std::size_t last = std::min(begin + split.grain, end);
+    (*split.body)(begin, last);
+    begin = last;
+  }
+}
+
+} // namespace engine
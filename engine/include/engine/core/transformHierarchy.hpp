@@ -0,0 +1,84 @@
+#pragma once
+
+#include "engine/ecs/entity.hpp"
+#include "engine/math/mat4.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace engine {
+
+// The transform hierarchy flattened into parallel arrays, parents before
+// children with every subtree stored contiguously from its root. World
+// matrices are computed by one forward pass, and a subtree is the range
+// [index, index + subtreeSize(index)). Nodes are entities with a
+// TransformComponent or a parent link, World keeps them in sync.
+// Attaching, detaching and erasing only relink the edited node and leave
+// the order stale; compact() restores it in one O(size()) pass.
+// Node order, subtreeSize() and update() are only valid after compact(),
+// the other accessors at any time.
+class TransformHierarchy {
+public:
+  static constexpr uint32_t None = UINT32_MAX;
+
+  // Adds entity as the last root, no-op if present
+  void insert(Entity entity);
+  // Removes entity, its children become roots. Its node stays behind, with
+  // NullEntity, until compact().
+  void erase(Entity entity);
+  // Drops the nodes of erased entities and puts the nodes back in parents
+  // first order, O(size()). No-op when nothing changed.
+  void compact();
+  // Moves child's subtree under parent, adding either if missing. Throws
+  // std::invalid_argument if parent is child or one of its descendants.
+  void attach(Entity child, Entity parent);
+  // Makes child's subtree a root
+  void detach(Entity child);
+  void clear();
+
+  // None if entity is not in the hierarchy
+  uint32_t indexOf(Entity entity) const;
+  bool contains(Entity entity) const { return indexOf(entity) != None; }
+  // True if entity is ancestor or one of its descendants, i.e. attaching
+  // ancestor under entity would make a cycle. O(1) after compact(), walks
+  // the parent links otherwise.
+  bool inSubtree(Entity entity, Entity ancestor) const;
+  // Node count, erased nodes included until compact()
+  std::size_t size() const { return entities.size(); }
+
+  // NullEntity for erased nodes
+  Entity entityAt(uint32_t index) const { return entities[index]; }
+  // None for roots, an erased node for its former children until compact()
+  uint32_t parentOf(uint32_t index) const { return parents[index]; }
+  uint32_t subtreeSize(uint32_t index) const { return sizes[index]; }
+  Mat4 &localMatrix(uint32_t index) { return local[index]; }
+  const Mat4 &worldMatrix(uint32_t index) const { return world[index]; }
+
+  // Recomputes the world matrices of [begin, end). Parents outside the range
+  // must be up to date, e.g. begin is a subtree root.
+  void update(uint32_t begin, uint32_t end);
+
+private:
+  // compact() when links changed: drops erased nodes and sorts the rest
+  // depth first
+  void reorder();
+  void computeSizes();
+
+  std::vector<Entity> entities;
+  std::vector<uint32_t> parents;
+  std::vector<uint32_t> sizes;
+  std::vector<Mat4> local;
+  std::vector<Mat4> world;
+  // node index by entity index
+  std::vector<uint32_t> slots;
+  // erased nodes waiting for compact()
+  std::size_t erased = 0;
+  // links changed since the last compact(), see reorder()
+  bool unordered = false;
+
+  // reorder() scratch, kept so it only grows
+  std::vector<uint32_t> childStart, children, fill, order, remap, stack;
+};
+
+} // namespace engine
@@ -4,17 +4,23 @@
 
 #include <cstdint>
 
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "engine/components/components.hpp"
+#include "engine/core/transformHierarchy.hpp"
 #include "engine/ecs/component.hpp"
 #include "engine/ecs/system.hpp"
+#include "engine/ecs/view.hpp"
 #include "engine/script/scriptRegistry.hpp"
 #include "engine/engineContext.hpp"
  
 namespace engine {
 
 class Script;
+class CommandBuffer;
 using ScriptPtr = std::shared_ptr<Script>;
 
 class World {
@@ -22,7 +28,27 @@ class World {
 public:
   using Entity = uint32_t;
 
+  explicit World(StorageMode storageMode = StorageMode::SparseSet);
+  ~World();
+
+  World(const World &) = delete;
+  World &operator=(const World &) = delete;
+
   Entity createEntity();
+  // Recreates a saved handle, falls back to a fresh entity if it is taken
+  Entity createEntityWithId(Entity id);
+  // Removes all of the entity's components, detaches it from its parent and
+  // turns its children into roots. Stale handles are ignored.
+  void destroyEntity(Entity entity);
+  bool isAlive(Entity entity) const;
+  // Thread-safe, the entity becomes alive on the next flushCommands()
+  Entity reserveEntity();
+
+  // Deferred structural changes. Each thread records into its own buffer;
+  // buffers are applied after every system update (and after start).
+  CommandBuffer &commands();
+  void flushCommands();
+
   void setCameraEntity(Entity c);
   Entity getCamera();
   void updateSystems(float dt);
@@ -34,6 +60,8 @@ public:
   void removeChild(Entity parent, Entity child);
   void removeAllChildren(Entity parent);
   std::vector<Entity> getChildren(Entity parent);
+  // Flat, parents-first mirror of the parent links, see TransformHierarchy
+  TransformHierarchy &getHierarchy();
 
   void registerDefaults();
   void clearStorages();
@@ -56,9 +84,25 @@ public:
 
   template <typename T> bool hasComponent(Entity entity);
 
+  // getComponent<const T> reads without marking the component as changed
   template <typename T> T &getComponent(Entity entity);
 
-  template <typename... Components> std::vector<Entity> view();
+  template <typename... Components> View<Components...> view();
+
+  // Change detection. Mutable access stamps components with the current
+  // tick; Changed<>/Added<> view terms and eachRemoved report what happened
+  // since the running system last ran (everything, outside of systems).
+  template <typename T> void markChanged(Entity entity);
+  // func(Entity) for every entity that lost T, removals stay queryable for
+  // one frame so every system sees each of them once
+  template <typename T, typename Func> void eachRemoved(Func &&func);
+  uint32_t getChangeTick() const;
+  // Called by SystemManager before each wave of systems
+  uint32_t advanceChangeTick();
+
+  // Creates T's storage now rather than on first use, so systems running
+  // concurrently never create one
+  template <typename T> void prepareStorage();
 
   void addScript(uint32_t entity, ScriptPtr script);
 
@@ -66,15 +110,25 @@ public:
   void registerScript(std::string name );
 
   const std::vector<Entity> &getEntities();
+  StorageMode getStorageMode() const;
 
 private:
-  std::vector<Entity> entities;
-  Entity _nextEntity = 1;
+  void assertAlive(Entity entity) const;
+
+  EntityRegistry entityRegistry;
   Entity _cameraE = 0;
   ComponentManager componentManager;
+  TransformHierarchy hierarchy;
+  uint32_t _frameTick = 0;
   SystemManager systemManager;
   ScriptRegistry scriptRegistry;
-  EngineContext* context;
+  EngineContext* context = nullptr;
+
+  const uint64_t _worldId;
+  std::mutex commandMutex;
+  std::vector<std::unique_ptr<CommandBuffer>> commandBuffers;
+  // thread each of commandBuffers belongs to
+  std::vector<std::thread::id> commandThreads;
 };
 
 template <typename T>
@@ -92,58 +146,80 @@ void World::registerComponent(
 
 template <typename T>
 void World::addComponent(Entity entity, const T &component) {
-  componentManager.getStorage<T>().add(entity, component);
+  assertAlive(entity);
+  componentManager.add<T>(entity, component);
 }
 
 template <>
 inline void
 World::addComponent<TransformComponent>(Entity e,
                                         const TransformComponent &transform) {
-  componentManager.getStorage<TransformComponent>().add(e, transform);
+  assertAlive(e);
+  componentManager.add<TransformComponent>(e, transform);
+  hierarchy.insert(e);
 
   if (!hasComponent<GlobalTransform>(e)) {
-    componentManager.getStorage<GlobalTransform>().add(
-        e, GlobalTransform{Mat4::identity()});
+    componentManager.add<GlobalTransform>(e, GlobalTransform{Mat4::identity()});
   }
 }
 
 template <typename T> void World::addComponent(Entity entity) {
-  componentManager.getStorage<T>().add(entity, T{});
+  assertAlive(entity);
+  componentManager.add<T>(entity, T{});
 }
 
 template <>
 inline void
 World::addComponent<TransformComponent>(Entity e) {
-  componentManager.getStorage<TransformComponent>().add(e, TransformComponent{});
+  assertAlive(e);
+  componentManager.add<TransformComponent>(e, TransformComponent{});
+  hierarchy.insert(e);
 
   if (!hasComponent<GlobalTransform>(e)) {
-    componentManager.getStorage<GlobalTransform>().add(
-        e, GlobalTransform{Mat4::identity()});
+    componentManager.add<GlobalTransform>(e, GlobalTransform{Mat4::identity()});
   }
 }
 
 
 template <typename T> void World::removeComponent(Entity entity) {
-  componentManager.getStorage<T>().remove(entity);
+  componentManager.remove<T>(entity);
+}
+
+// Drops the entity's hierarchy node too, so HierarchySystem stops writing
+// its GlobalTransform and its children become roots, as in destroyEntity
+template <>
+inline void World::removeComponent<TransformComponent>(Entity e) {
+  if (!hasComponent<TransformComponent>(e))
+    return;
+  componentManager.remove<TransformComponent>(e);
+  hierarchy.erase(e);
 }
 
 
 
 template <typename T> bool World::hasComponent(Entity entity) {
-  return componentManager.getStorage<T>().has(entity);
+  return componentManager.has<T>(entity);
 }
 
 template <typename T> T &World::getComponent(Entity entity) {
-  return componentManager.getStorage<T>().get(entity);
+  return componentManager.get<T>(entity);
 }
-template <typename... Components> std::vector<Entity> World::view() {
-  std::vector<Entity> result;
-  for (Entity e : entities) {
-    if ((hasComponent<Components>(e) && ...)) {
-      result.push_back(e);
-    }
-  }
-  return result;
+template <typename... Components> View<Components...> World::view() {
+  return View<Components...>(componentManager,
+                             context ? context->jobs : nullptr);
+}
+
+template <typename T> void World::markChanged(Entity entity) {
+  componentManager.markChanged<T>(entity);
+}
+
+template <typename T> void World::prepareStorage() {
+  if (getStorageMode() == StorageMode::SparseSet)
+    componentManager.getStorage<T>();
+}
+
+template <typename T, typename Func> void World::eachRemoved(Func &&func) {
+  componentManager.eachRemoved<T>(std::forward<Func>(func));
 }
 
 } // namespace engine
@@ -0,0 +1,242 @@
+#pragma once
+
+#include "engine/ecs/changeTick.hpp"
+#include "engine/ecs/componentType.hpp"
+#include "engine/ecs/entity.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace engine {
+
+// Type-erased operations the archetype backend needs to relocate components
+// between chunks. One instance per component type.
+struct ComponentInfo {
+  std::size_t typeId;
+  std::size_t size;
+  std::size_t align;
+  // trivially copyable: relocated with memcpy, never destroyed
+  bool trivial;
+  void (*moveConstruct)(void *dst, void *src);
+  void (*destroy)(void *ptr);
+
+  // Moves the component at src to uninitialized dst and ends src's lifetime
+  void relocate(void *dst, void *src) const;
+
+  template <typename T> static const ComponentInfo *of() {
+    static const ComponentInfo info{
+        ComponentTypeId::get<T>(), sizeof(T), alignof(T),
+        std::is_trivially_copyable_v<T>,
+        [](void *dst, void *src) {
+          new (dst) T(std::move(*static_cast<T *>(src)));
+        },
+        [](void *ptr) { static_cast<T *>(ptr)->~T(); }};
+    return &info;
+  }
+};
+
+// All entities sharing one component signature, stored in fixed-size chunks
+// with one tightly packed column per component type (plus the entity column).
+// Each column has added/changed tick arrays next to it in the chunk.
+// Rows are kept dense: removing a row moves the last row into it.
+class Archetype {
+public:
+  static constexpr std::size_t ChunkSize = 16 * 1024;
+
+  explicit Archetype(std::vector<const ComponentInfo *> signature);
+  ~Archetype();
+
+  Archetype(const Archetype &) = delete;
+  Archetype &operator=(const Archetype &) = delete;
+
+  const std::vector<const ComponentInfo *> &signature() const {
+    return _signature;
+  }
+  int columnOf(const ComponentInfo *info) const {
+    return info->typeId < columnByType.size() ? columnByType[info->typeId]
+                                              : -1;
+  }
+
+  std::size_t size() const { return _size; }
+  std::size_t capacity() const { return _capacity; }
+  std::size_t chunkCount() const { return chunks.size(); }
+  std::size_t chunkSize(std::size_t chunk) const;
+
+  Entity *entities(std::size_t chunk) {
+    return reinterpret_cast<Entity *>(chunks[chunk]->bytes);
+  }
+  void *columnData(std::size_t chunk, int column) {
+    return chunks[chunk]->bytes + offsets[column];
+  }
+  template <typename T> T *columnData(std::size_t chunk, int column) {
+    return std::launder(static_cast<T *>(columnData(chunk, column)));
+  }
+  uint32_t *addedTicks(std::size_t chunk, int column) {
+    return reinterpret_cast<uint32_t *>(chunks[chunk]->bytes +
+                                        tickOffsets[column]);
+  }
+  uint32_t *changedTicks(std::size_t chunk, int column) {
+    return addedTicks(chunk, column) + _capacity;
+  }
+
+  Entity entityAt(uint32_t row);
+  void *component(uint32_t row, int column);
+  uint32_t &addedTick(uint32_t row, int column) {
+    return addedTicks(row / _capacity, column)[row % _capacity];
+  }
+  uint32_t &changedTick(uint32_t row, int column) {
+    return changedTicks(row / _capacity, column)[row % _capacity];
+  }
+
+  // Reserves a row for entity, component slots are left unconstructed
+  uint32_t allocate(Entity entity);
+  // Fills the hole of a row whose components were already relocated or
+  // destroyed with the last row. Returns true and sets moved if another
+  // entity changed rows.
+  bool removeRow(uint32_t row, Entity &moved);
+  void clear();
+
+  // Archetype reached by adding/removing a component, indexed by type id,
+  // nullptr until first taken
+  std::vector<Archetype *> addEdges;
+  std::vector<Archetype *> removeEdges;
+
+private:
+  struct alignas(64) Chunk {
+    unsigned char bytes[ChunkSize];
+  };
+
+  std::vector<const ComponentInfo *> _signature;
+  std::vector<std::size_t> offsets;
+  std::vector<std::size_t> tickOffsets;
+  std::vector<int> columnByType;
+  std::vector<std::unique_ptr<Chunk>> chunks;
+  // last chunk emptied, kept so an entity moving back and forth across a
+  // chunk boundary doesn't allocate every time
+  std::unique_ptr<Chunk> spare;
+  std::size_t _capacity = 0;
+  std::size_t _size = 0;
+};
+
+// Archetype ECS backend: entities move between archetypes as their
+// signature changes. References returned by get() are invalidated by any
+// structural change in the same archetype. get() marks the component as
+// changed at the current tick, peek() does not.
+class ArchetypeStorage {
+public:
+  explicit ArchetypeStorage(const ChangeTicks *ticks) : ticks(ticks) {}
+
+  template <typename T> void add(Entity entity, const T &component);
+  // true if the entity had the component
+  template <typename T> bool remove(Entity entity);
+  template <typename T> T &get(Entity entity);
+  template <typename T> const T &peek(Entity entity);
+  template <typename T> bool has(Entity entity);
+  template <typename T> void markChanged(Entity entity);
+
+  void destroy(Entity entity);
+  void clear();
+
+  // nullptr when the entity has no components
+  Archetype *archetypeOf(Entity entity);
+  const std::vector<Archetype *> &getArchetypes() const { return ordered; }
+
+private:
+  struct Record {
+    Archetype *archetype = nullptr;
+    uint32_t row = 0;
+  };
+
+  Record *find(Entity entity);
+  Record &assure(Entity entity);
+  Archetype *archetypeWith(Archetype *from, const ComponentInfo *info);
+  Archetype *archetypeWithout(Archetype *from, const ComponentInfo *info);
+  Archetype *archetypeFor(std::vector<const ComponentInfo *> signature);
+  void move(Entity entity, Record &record, Archetype *to);
+  template <typename T> int columnIn(Record *record);
+
+  const ChangeTicks *ticks;
+  std::vector<Record> records;
+  std::map<std::vector<const ComponentInfo *>, std::unique_ptr<Archetype>>
+      archetypes;
+  std::vector<Archetype *> ordered;
+};
+
+template <typename T>
+void ArchetypeStorage::add(Entity entity, const T &component) {
+  const ComponentInfo *info = ComponentInfo::of<T>();
+  Record &record = assure(entity);
+  if (record.archetype && record.archetype->entityAt(record.row) != entity)
+    throw std::invalid_argument("Stale entity handle");
+  if (record.archetype) {
+    int column = record.archetype->columnOf(info);
+    if (column >= 0) {
+      *static_cast<T *>(record.archetype->component(record.row, column)) =
+          component;
+      record.archetype->changedTick(record.row, column) = ticks->current;
+      return;
+    }
+  }
+
+  Archetype *target = archetypeWith(record.archetype, info);
+  move(entity, record, target);
+  int column = target->columnOf(info);
+  new (target->component(record.row, column)) T(component);
+  target->addedTick(record.row, column) = ticks->current;
+  target->changedTick(record.row, column) = ticks->current;
+}
+
+template <typename T> bool ArchetypeStorage::remove(Entity entity) {
+  const ComponentInfo *info = ComponentInfo::of<T>();
+  Record *record = find(entity);
+  if (!record || !record->archetype || record->archetype->columnOf(info) < 0)
+    return false;
+
+  move(entity, *record, archetypeWithout(record->archetype, info));
+  return true;
+}
+
+template <typename T> int ArchetypeStorage::columnIn(Record *record) {
+  return record && record->archetype
+             ? record->archetype->columnOf(ComponentInfo::of<T>())
+             : -1;
+}
+
+template <typename T> T &ArchetypeStorage::get(Entity entity) {
+  Record *record = find(entity);
+  int column = columnIn<T>(record);
+  if (column < 0)
+    throw std::out_of_range("Entity has no such component");
+  record->archetype->changedTick(record->row, column) = ticks->current;
+  return *std::launder(
+      static_cast<T *>(record->archetype->component(record->row, column)));
+}
+
+template <typename T> const T &ArchetypeStorage::peek(Entity entity) {
+  Record *record = find(entity);
+  int column = columnIn<T>(record);
+  if (column < 0)
+    throw std::out_of_range("Entity has no such component");
+  return *std::launder(
+      static_cast<T *>(record->archetype->component(record->row, column)));
+}
+
+template <typename T> bool ArchetypeStorage::has(Entity entity) {
+  return columnIn<T>(find(entity)) >= 0;
+}
+
+template <typename T> void ArchetypeStorage::markChanged(Entity entity) {
+  Record *record = find(entity);
+  int column = columnIn<T>(record);
+  if (column >= 0)
+    record->archetype->changedTick(record->row, column) = ticks->current;
+}
+
+} // namespace engine
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+namespace engine {
+
+// Change detection clock shared by a World's storages. `current` advances
+// before every wave of systems and is stamped on components when they are
+// added or accessed mutably. `lastRun` is the tick of the previous run of the
+// system executing on this thread (0 outside systems), Changed<>/Added<>
+// filters and removal queries report anything newer than it.
+struct ChangeTicks {
+  uint32_t current = 1;
+  static inline thread_local uint32_t lastRun = 0;
+
+  static bool isNew(uint32_t tick) { return tick > lastRun; }
+};
+
+} // namespace engine
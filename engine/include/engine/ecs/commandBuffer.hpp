@@ -0,0 +1,114 @@
+#pragma once
+
+#include "engine/core/world.hpp"
+#include "engine/ecs/componentType.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace engine {
+
+// Records structural changes (create/destroy entities, add/remove
+// components, re-parenting) to be applied later by World::flushCommands().
+// Component operations are bucketed per component type so a flush applies
+// each storage's changes in one batch. Get one through World::commands(),
+// which hands every thread its own buffer.
+class CommandBuffer {
+public:
+  explicit CommandBuffer(World &world) : world(world) {}
+
+  // The handle can be used in this buffer right away, it becomes alive on
+  // the next flush
+  Entity createEntity();
+  void destroyEntity(Entity entity);
+
+  template <typename T> void addComponent(Entity entity, const T &component);
+  template <typename T> void addComponent(Entity entity);
+  template <typename T> void removeComponent(Entity entity);
+
+  void setParent(Entity child, Entity parent);
+  void removeParent(Entity child);
+
+  bool empty() const;
+
+private:
+  friend class World;
+
+  struct IQueue {
+    virtual ~IQueue() = default;
+    virtual void apply(World &world) = 0;
+    virtual void clear() = 0;
+  };
+
+  template <typename T> struct ComponentQueue : IQueue {
+    static constexpr uint32_t Remove = ~uint32_t(0);
+    struct Op {
+      Entity entity;
+      uint32_t value; // index into values, or Remove
+    };
+    std::vector<Op> ops;
+    std::vector<T> values;
+
+    void apply(World &world) override {
+      for (const Op &op : ops) {
+        if (!world.isAlive(op.entity))
+          continue;
+        if (op.value == Remove)
+          world.removeComponent<T>(op.entity);
+        else
+          world.addComponent<T>(op.entity, values[op.value]);
+      }
+      clear();
+    }
+    void clear() override {
+      ops.clear();
+      values.clear();
+    }
+  };
+
+  struct ParentOp {
+    Entity child;
+    Entity parent; // NullEntity to detach
+  };
+
+  template <typename T> ComponentQueue<T> &queue();
+  void clear();
+
+  World &world;
+  std::vector<Entity> created;
+  std::vector<Entity> destroyed;
+  std::vector<ParentOp> parentOps;
+  // indexed by ComponentTypeId
+  std::vector<std::unique_ptr<IQueue>> queues;
+  std::size_t pending = 0;
+};
+
+template <typename T>
+CommandBuffer::ComponentQueue<T> &CommandBuffer::queue() {
+  std::size_t id = ComponentTypeId::get<T>();
+  if (id >= queues.size())
+    queues.resize(id + 1);
+  if (!queues[id])
+    queues[id] = std::make_unique<ComponentQueue<T>>();
+  return *static_cast<ComponentQueue<T> *>(queues[id].get());
+}
+
+template <typename T>
+void CommandBuffer::addComponent(Entity entity, const T &component) {
+  auto &q = queue<T>();
+  q.ops.push_back({entity, static_cast<uint32_t>(q.values.size())});
+  q.values.push_back(component);
+  ++pending;
+}
+
+template <typename T> void CommandBuffer::addComponent(Entity entity) {
+  addComponent<T>(entity, T{});
+}
+
+template <typename T> void CommandBuffer::removeComponent(Entity entity) {
+  queue<T>().ops.push_back({entity, ComponentQueue<T>::Remove});
+  ++pending;
+}
+
+} // namespace engine
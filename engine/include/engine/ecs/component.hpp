@@ -2,11 +2,20 @@
 
 #include <SDL2/SDL.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
-#include <typeindex>
+#include <new>
+#include <stdexcept>
 #include <unordered_map>
 #include <functional>
 #include <memory>
+#include <vector>
+#include "engine/ecs/archetype.hpp"
+#include "engine/ecs/changeTick.hpp"
+#include "engine/ecs/componentType.hpp"
+#include "engine/ecs/systemAccess.hpp"
+#include "engine/ecs/entity.hpp"
 #include "engine/thirdparty/nlohmann/json.hpp"
  
   
@@ -34,83 +43,398 @@ namespace engine{
 
 struct IComponentStorage {
     virtual ~IComponentStorage() = default;
+    // true if the entity had the component
+    virtual bool remove(Entity entity) = 0;
     virtual void clear() = 0;
 };
 
 
+  // Sparse set: a paged sparse index maps an entity's slot index to its
+  // position in the densely packed entity/component arrays. Components live in fixed-size
+  // pages, so references stay valid while the storage grows; removing an
+  // entity moves the last component into the freed slot.
+  // Every slot also records the tick it was added and last accessed mutably
+  // (get/tryGet), peek/tryPeek read without marking a change.
   template<typename T>
-  class ComponentStorage : public IComponentStorage{
+  class ComponentStorage final : public IComponentStorage{
   public:
-      std::unordered_map<Entity, T> components;
+      static constexpr std::size_t SparsePageSize = 4096;
+      static constexpr std::size_t PageSize = 1024;
+      static constexpr uint32_t Null = ~uint32_t(0);
+
+      explicit ComponentStorage(const ChangeTicks* ticks = nullptr)
+          : ticks(ticks ? ticks : &NoTicks) {}
+      ComponentStorage(const ComponentStorage&) = delete;
+      ComponentStorage& operator=(const ComponentStorage&) = delete;
+      ~ComponentStorage() override { clear(); }
 
       void add(Entity entity, const T& component); 
 
-      void remove(Entity entity) ;
+      bool remove(Entity entity) override;
 
       T& get(Entity entity) ;
+      const T& peek(Entity entity) const;
+
+      // nullptr when the entity has no such component
+      T* tryGet(Entity entity);
+      const T* tryPeek(Entity entity) const;
 
       bool has(Entity entity);
+      void markChanged(Entity entity);
 
-    void clear(){
-    components.clear();
-  }
+      void clear() override;
+
+      // Dense access, entities()[i] owns at(i). at() does not mark a change.
+      std::size_t size() const { return dense.size(); }
+      const std::vector<Entity>& entities() const { return dense; }
+      T& at(std::size_t index) { return *slot(index); }
+      // Null when the entity has no such component
+      uint32_t indexOf(Entity entity) const { return sparseIndex(entity); }
+      uint32_t addedTick(std::size_t index) const { return added[index]; }
+      uint32_t changedTick(std::size_t index) const { return changed[index]; }
+      void touch(std::size_t index) { changed[index] = ticks->current; }
+
+  private:
+      static constexpr ChangeTicks NoTicks{};
+      struct Slot {
+        alignas(T) unsigned char bytes[sizeof(T)];
+      };
+      // cache line aligned, so slot ranges split on line boundaries
+      struct alignas(64) Page {
+        Slot slots[PageSize];
+      };
+
+      uint32_t sparseIndex(Entity entity) const;
+      uint32_t& assureSparse(Entity entity);
+      T* slot(std::size_t index) const {
+        return std::launder(reinterpret_cast<T*>(
+            pages[index / PageSize]->slots[index % PageSize].bytes));
+      }
+
+      const ChangeTicks* ticks;
+      std::vector<std::unique_ptr<uint32_t[]>> sparse;
+      std::vector<Entity> dense;
+      std::vector<uint32_t> added;
+      std::vector<uint32_t> changed;
+      std::vector<std::unique_ptr<Page>> pages;
   };
+  // How a World lays out its components: one sparse set per component type,
+  // or archetype chunks grouping entities with the same component signature.
+  enum class StorageMode { SparseSet, Archetype };
+
   class ComponentManager {
   private:
-      std::unordered_map<std::type_index, std::shared_ptr<IComponentStorage>> storages;
+      ChangeTicks ticks;
+      // indexed by ComponentTypeId
+      std::vector<std::unique_ptr<IComponentStorage>> storages;
+      ArchetypeStorage archetypes;
+      StorageMode mode;
       ComponentSerializerRegistry serializerRegistry;
 
+      struct Removal {
+        Entity entity;
+        uint32_t tick;
+      };
+      // indexed by ComponentTypeId
+      std::vector<std::vector<Removal>> removed;
+
   public:
+      explicit ComponentManager(StorageMode mode = StorageMode::SparseSet)
+          : archetypes(&ticks), mode(mode) {}
+
+      // T may be const-qualified: get<const T> reads without marking a change
+      template<typename T> void add(Entity entity, const T& component);
+      template<typename T> void remove(Entity entity);
+      template<typename T> T& get(Entity entity);
+      template<typename T> bool has(Entity entity);
+      template<typename T> void markChanged(Entity entity);
+
       template<typename T>
       void registerComponent(const std::string& name,  std::function<json(World&, Entity)> to_json,
                                  std::function<void(World&, Entity, const json&)> from_json);
 
       template<typename T>
       ComponentStorage<T>& getStorage(); 
+      // Raw pointer fast path, nullptr until the type's storage exists
+      template<typename T>
+      ComponentStorage<T>* findStorage();
       ComponentSerializerRegistry& getSerializerRegistry();
+      StorageMode getStorageMode() const { return mode; }
+      ArchetypeStorage& getArchetypeStorage() { return archetypes; }
 
+      ChangeTicks& getTicks() { return ticks; }
+      const ChangeTicks& getTicks() const { return ticks; }
+      // Calls func(Entity) for every T removed since ChangeTicks::lastRun
+      template<typename T, typename Func> void eachRemoved(Func&& func) const;
+      // Drops removal records stamped at or before tick
+      void trimRemoved(uint32_t tick);
+
+      // Removes every component of entity
+      void destroy(Entity entity);
       void clearStorages();
+
+      // While locked (a View being iterated), structural changes throw
+      void lockStructure() { ++structureLocks; }
+      void unlockStructure() { --structureLocks; }
+      // Throws while locked. World calls it before changes that touch more
+      // than the components, so they fail before anything changed
+      void assertUnlocked() const {
+        if (structureLocks.load() != 0)
+          throw std::logic_error(
+              "Structural change while a view is iterated, use World::commands()");
+      }
+
+  private:
+      std::atomic<int> structureLocks{0};
+      template<typename T>
+      ComponentStorage<T>& createStorage();
+      // Existing storage for lookups, which may run on several threads and
+      // so never create one. Throws like a missing component if there is none.
+      template<typename T>
+      ComponentStorage<T>& storageOf();
+      void logRemoval(std::size_t typeId, Entity entity);
   };
   //MANAGER
   template<typename T>
   void ComponentManager::registerComponent(const std::string& name,  std::function<json(World&, Entity)> to_json,
                                  std::function<void(World&, Entity, const json&)> from_json){
-    std::type_index type = std::type_index(typeid(T));
-    storages[type] = std::make_shared<ComponentStorage<T>>();
+    // archetype mode keeps components in chunks, a sparse storage would
+    // never be used
+    if (mode == StorageMode::SparseSet)
+      createStorage<T>();
 
-    auto has_component = [this](World& world, Entity e){return this->getStorage<T>().has(e);};
+    auto has_component = [this](World& world, Entity e){return this->has<T>(e);};
     
     ComponentSerializer c{to_json, from_json, has_component};
     serializerRegistry.registerSerializer(name,c);
   }
 
+  template<typename T>
+  ComponentStorage<T>& ComponentManager::createStorage(){
+    std::size_t id = ComponentTypeId::get<T>();
+    if (id >= storages.size())
+      storages.resize(id + 1);
+    storages[id] = std::make_unique<ComponentStorage<T>>(&ticks);
+    return *static_cast<ComponentStorage<T>*>(storages[id].get());
+  }
+
+  template<typename T>
+  ComponentStorage<T>* ComponentManager::findStorage(){
+    std::size_t id = ComponentTypeId::get<T>();
+    return id < storages.size()
+               ? static_cast<ComponentStorage<T>*>(storages[id].get())
+               : nullptr;
+  }
+
   template<typename T>
   ComponentStorage<T>& ComponentManager::getStorage(){
-    std::type_index type = std::type_index(typeid(T));
-    return *std::static_pointer_cast<ComponentStorage<T>>(storages[type]);
+    ComponentStorage<T>* storage = findStorage<T>();
+    return storage ? *storage : createStorage<T>();
+  }
 
+  template<typename T>
+  ComponentStorage<T>& ComponentManager::storageOf(){
+    ComponentStorage<T>* storage = findStorage<T>();
+    if (!storage)
+      throw std::out_of_range("Entity has no such component");
+    return *storage;
+  }
+
+  template<typename T>
+  void ComponentManager::add(Entity entity, const T& component){
+    SystemAccess::checkStructural(ComponentTypeId::get<T>());
+    assertUnlocked();
+    if (mode == StorageMode::Archetype)
+      archetypes.add<T>(entity, component);
+    else
+      getStorage<T>().add(entity, component);
+  }
+
+  template<typename T>
+  void ComponentManager::remove(Entity entity){
+    SystemAccess::checkStructural(ComponentTypeId::get<T>());
+    assertUnlocked();
+    bool removedOne;
+    if (mode == StorageMode::Archetype)
+      removedOne = archetypes.remove<T>(entity);
+    else {
+      ComponentStorage<T>* storage = findStorage<T>();
+      removedOne = storage && storage->remove(entity);
+    }
+    if (removedOne)
+      logRemoval(ComponentTypeId::get<T>(), entity);
+  }
+
+  template<typename T>
+  T& ComponentManager::get(Entity entity){
+    using C = std::remove_const_t<T>;
+    if constexpr (std::is_const_v<T>) {
+      SystemAccess::checkRead(ComponentTypeId::get<C>());
+      if (mode == StorageMode::Archetype)
+        return archetypes.peek<C>(entity);
+      return storageOf<C>().peek(entity);
+    } else {
+      SystemAccess::checkWrite(ComponentTypeId::get<C>());
+      if (mode == StorageMode::Archetype)
+        return archetypes.get<C>(entity);
+      return storageOf<C>().get(entity);
+    }
+  }
+
+  template<typename T>
+  bool ComponentManager::has(Entity entity){
+    using C = std::remove_const_t<T>;
+    SystemAccess::checkRead(ComponentTypeId::get<C>());
+    if (mode == StorageMode::Archetype)
+      return archetypes.has<C>(entity);
+    ComponentStorage<C>* storage = findStorage<C>();
+    return storage && storage->has(entity);
+  }
+
+  template<typename T>
+  void ComponentManager::markChanged(Entity entity){
+    using C = std::remove_const_t<T>;
+    SystemAccess::checkWrite(ComponentTypeId::get<C>());
+    if (mode == StorageMode::Archetype)
+      archetypes.markChanged<C>(entity);
+    else if (ComponentStorage<C>* storage = findStorage<C>())
+      storage->markChanged(entity);
+  }
+
+  template<typename T, typename Func>
+  void ComponentManager::eachRemoved(Func&& func) const {
+    std::size_t id = ComponentTypeId::get<T>();
+    if (id >= removed.size())
+      return;
+    for (const Removal& removal : removed[id]) {
+      if (ChangeTicks::isNew(removal.tick))
+        func(removal.entity);
+    }
   }
 
   //STORAGE
   //
+  template<typename T>
+  uint32_t ComponentStorage<T>::sparseIndex(Entity entity) const {
+      uint32_t slotIndex = entityIndex(entity);
+      std::size_t page = slotIndex / SparsePageSize;
+      if (page >= sparse.size() || !sparse[page])
+        return Null;
+      uint32_t index = sparse[page][slotIndex % SparsePageSize];
+      // a stale handle shares the slot index but not the generation
+      return index != Null && dense[index] == entity ? index : Null;
+  }
+
+  template<typename T>
+  uint32_t& ComponentStorage<T>::assureSparse(Entity entity) {
+      uint32_t slotIndex = entityIndex(entity);
+      std::size_t page = slotIndex / SparsePageSize;
+      if (page >= sparse.size())
+        sparse.resize(page + 1);
+      if (!sparse[page]) {
+        sparse[page] = std::make_unique<uint32_t[]>(SparsePageSize);
+        std::fill_n(sparse[page].get(), SparsePageSize, Null);
+      }
+      return sparse[page][slotIndex % SparsePageSize];
+  }
+
   template<typename T>
   void ComponentStorage<T>::add(Entity entity, const T& component) {
-      components[entity] = component;
+      uint32_t existing = sparseIndex(entity);
+      if (existing != Null) {
+        *slot(existing) = component;
+        changed[existing] = ticks->current;
+        return;
+      }
+      uint32_t& index = assureSparse(entity);
+      if (index != Null)
+        throw std::invalid_argument("Stale entity handle");
+
+      std::size_t next = dense.size();
+      if (next / PageSize >= pages.size())
+        pages.push_back(std::unique_ptr<Page>(new Page));
+      new (pages[next / PageSize]->slots[next % PageSize].bytes) T(component);
+      index = static_cast<uint32_t>(next);
+      dense.push_back(entity);
+      added.push_back(ticks->current);
+      changed.push_back(ticks->current);
   }
 
   template<typename T>
-  void ComponentStorage<T>::remove(Entity entity) {
-      components.erase(entity);
+  bool ComponentStorage<T>::remove(Entity entity) {
+      uint32_t index = sparseIndex(entity);
+      if (index == Null)
+        return false;
+
+      std::size_t last = dense.size() - 1;
+      if (index != last) {
+        *slot(index) = std::move(*slot(last));
+        dense[index] = dense[last];
+        added[index] = added[last];
+        changed[index] = changed[last];
+        assureSparse(dense[index]) = index;
+      }
+      slot(last)->~T();
+      dense.pop_back();
+      added.pop_back();
+      changed.pop_back();
+      assureSparse(entity) = Null;
+      return true;
   }
 
   template<typename T>
   T& ComponentStorage<T>::get(Entity entity) {
-      return components.at(entity);
+      uint32_t index = sparseIndex(entity);
+      if (index == Null)
+        throw std::out_of_range("Entity has no such component");
+      changed[index] = ticks->current;
+      return *slot(index);
+  }
+
+  template<typename T>
+  const T& ComponentStorage<T>::peek(Entity entity) const {
+      uint32_t index = sparseIndex(entity);
+      if (index == Null)
+        throw std::out_of_range("Entity has no such component");
+      return *slot(index);
+  }
+
+  template<typename T>
+  T* ComponentStorage<T>::tryGet(Entity entity) {
+      uint32_t index = sparseIndex(entity);
+      if (index == Null)
+        return nullptr;
+      changed[index] = ticks->current;
+      return slot(index);
+  }
+
+  template<typename T>
+  const T* ComponentStorage<T>::tryPeek(Entity entity) const {
+      uint32_t index = sparseIndex(entity);
+      return index == Null ? nullptr : slot(index);
   }
 
   template<typename T>
   bool ComponentStorage<T>::has(Entity entity) {
-      return components.find(entity) != components.end();
+      return sparseIndex(entity) != Null;
+  }
+
+  template<typename T>
+  void ComponentStorage<T>::markChanged(Entity entity) {
+      uint32_t index = sparseIndex(entity);
+      if (index != Null)
+        changed[index] = ticks->current;
+  }
+
+  template<typename T>
+  void ComponentStorage<T>::clear() {
+      for (std::size_t i = 0; i < dense.size(); ++i)
+        slot(i)->~T();
+      dense.clear();
+      added.clear();
+      changed.clear();
+      pages.clear();
+      sparse.clear();
   }
 
 
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace engine {
+
+// Dense per-type id, assigned once on first use. Used to index flat storage
+// tables instead of hashing std::type_index on every access.
+class ComponentTypeId {
+  static inline std::atomic<std::size_t> counter{0};
+
+  template <typename T> static std::size_t assign() {
+    static const std::size_t id = counter++;
+    return id;
+  }
+
+public:
+  template <typename T> static std::size_t get() {
+    return assign<std::remove_cv_t<T>>();
+  }
+  static std::size_t count() { return counter.load(); }
+};
+
+} // namespace engine
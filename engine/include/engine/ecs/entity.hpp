@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace engine {
+using Entity = uint32_t;
+
+// An entity handle packs a slot index (low bits) with the generation of that
+// slot (high bits). Destroying an entity bumps its slot's generation, so
+// handles kept around after destruction no longer match anything.
+constexpr uint32_t EntityIndexBits = 20;
+constexpr Entity EntityIndexMask = (Entity(1) << EntityIndexBits) - 1;
+constexpr uint32_t EntityGenerationMask = (1u << (32 - EntityIndexBits)) - 1;
+constexpr Entity NullEntity = 0;
+
+inline uint32_t entityIndex(Entity entity) { return entity & EntityIndexMask; }
+inline uint32_t entityGeneration(Entity entity) {
+  return entity >> EntityIndexBits;
+}
+inline Entity makeEntity(uint32_t index, uint32_t generation) {
+  return (generation & EntityGenerationMask) << EntityIndexBits | index;
+}
+
+// Hands out entity handles, recycling destroyed slots from a free list.
+// Slot 0 is never used so that NullEntity stays invalid.
+//
+// Slots are reused oldest first and only once MinFreeSlots are free, so a
+// slot's generation advances once per MinFreeSlots destructions rather than
+// once per destruction. A slot whose generation would wrap is retired
+// instead of reused, so a stale handle never becomes alive again.
+class EntityRegistry {
+public:
+  static constexpr std::size_t MinFreeSlots = 1024;
+
+  Entity create();
+  // Recreates a specific handle (scene loading), NullEntity if its slot is
+  // alive, reserved or retired
+  Entity create(Entity requested);
+  // Thread-safe: claims a free slot, or a fresh one, without touching the
+  // tables. The handle becomes alive once materialize() is called for it.
+  Entity reserve();
+  void materialize(Entity reserved);
+  void destroy(Entity entity);
+  bool alive(Entity entity) const;
+  void clear();
+
+  // Alive entities, in no particular order
+  const std::vector<Entity> &getEntities() const { return entities; }
+
+private:
+  Entity activate(uint32_t index, uint32_t generation);
+  Entity reserveFresh();
+
+  std::atomic<uint32_t> nextIndex{1};
+  std::vector<uint32_t> generations{0};
+  std::vector<uint32_t> aliveSlot{Dead}; // position in entities, or Dead
+  // destroyed slots as the handles they will be reused with, oldest first,
+  // guarded by freeMutex since reserve() pops from it on any thread
+  std::deque<Entity> freeList;
+  std::mutex freeMutex;
+  std::vector<Entity> entities;
+
+  static constexpr uint32_t Dead = ~uint32_t(0);
+};
+
+} // namespace engine
@@ -1,11 +1,14 @@
 #pragma once
 
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 
 
 #include <vector>
 
+#include "engine/ecs/systemAccess.hpp"
 
 
 namespace engine {
@@ -15,9 +18,16 @@ class System {
   public:
       virtual void start(World& world) = 0;
       virtual void update(World& world,float dt) = 0; 
+      // Declares what the system touches, see SystemAccess. Systems that
+      // declare nothing run alone.
+      virtual void declareAccess(SystemAccess& access) {}
       virtual ~System() = default;
 };
 
+// Runs systems in waves: a system waits for every earlier-registered system
+// it conflicts with and for its before/after constraints, systems within a
+// wave run concurrently on the world's EngineContext job system (one after
+// another without one). Commands are flushed after each wave.
 class SystemManager {
   public:
       void addSystem(std::shared_ptr<System> system);
@@ -25,7 +35,18 @@ class SystemManager {
       void startAll(World& world);
 
   private:
+      void schedule(World& world);
+      void run(World& world, const std::function<void(System&)>& call);
+      void runOne(std::size_t index, const std::function<void(System&)>& call);
+
       std::vector<std::shared_ptr<System>> systems;
+      // parallel to systems
+      std::vector<SystemAccess> access;
+      // change tick of each system's previous run, parallel to systems
+      std::vector<uint32_t> lastRun;
+      // indices into systems, main-thread systems first in each wave
+      std::vector<std::vector<std::size_t>> waves;
+      bool scheduled = false;
   };
 
 }
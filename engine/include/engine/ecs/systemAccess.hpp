@@ -0,0 +1,149 @@
+#pragma once
+
+#include "engine/ecs/changeTick.hpp"
+#include "engine/ecs/componentType.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <vector>
+
+namespace engine {
+
+class World;
+
+// Component access a system declares in System::declareAccess(). Systems
+// whose accesses do not conflict (no type written by one and used by the
+// other) may run concurrently; a system that declares nothing runs alone.
+//
+//   void declareAccess(SystemAccess &access) override {
+//     access.read<TransformComponent>().write<GlobalTransform>()
+//           .after<CameraControllerSystem>();
+//   }
+//
+// Declared systems must read through const access (getComponent<const T>,
+// view<const T>) and record structural changes with World::commands().
+class SystemAccess {
+public:
+  template <typename T> SystemAccess &read() {
+    declare<T>(reads);
+    return *this;
+  }
+  template <typename T> SystemAccess &write() {
+    declare<T>(writes);
+    return *this;
+  }
+  // Runs before/after every system of type S it is scheduled with
+  template <typename S> SystemAccess &before() {
+    _before.emplace_back(typeid(S));
+    return *this;
+  }
+  template <typename S> SystemAccess &after() {
+    _after.emplace_back(typeid(S));
+    return *this;
+  }
+  // Always run on the thread calling World::updateSystems
+  SystemAccess &mainThread() {
+    _mainThread = true;
+    return *this;
+  }
+
+  bool declared() const { return _declared; }
+  bool conflicts(const SystemAccess &other) const;
+  bool canRead(std::size_t typeId) const;
+  bool canWrite(std::size_t typeId) const;
+
+  // Debug validation: while enabled, a declared system touching a component
+  // outside its declaration, or making a structural change directly, throws
+  // std::runtime_error.
+  static void setValidation(bool enabled) { validation = enabled; }
+  static bool validating() { return validation.load(std::memory_order_relaxed); }
+
+  static void checkRead(std::size_t typeId) {
+    if (validating() && current && !current->canRead(typeId))
+      fail("read of undeclared component type ", typeId);
+  }
+  static void checkWrite(std::size_t typeId) {
+    if (validating() && current && !current->canWrite(typeId))
+      fail("write to undeclared component type ", typeId);
+  }
+  static void checkStructural(std::size_t typeId) {
+    if (validating() && current)
+      fail("direct structural change to component type ", typeId);
+  }
+
+  // Declaration of the system running on this thread, or whose work it is
+  // doing (see SystemContext). nullptr outside systems and for undeclared
+  // ones.
+  static inline thread_local const SystemAccess *current = nullptr;
+
+private:
+  friend class SystemManager;
+
+  template <typename T> void declare(std::vector<std::size_t> &types) {
+    using C = std::remove_const_t<T>;
+    types.push_back(ComponentTypeId::get<C>());
+    prepare.push_back([](auto &world) { world.template prepareStorage<C>(); });
+    _declared = true;
+  }
+  static bool contains(const std::vector<std::size_t> &types,
+                       std::size_t typeId) {
+    return std::find(types.begin(), types.end(), typeId) != types.end();
+  }
+  [[noreturn]] static void fail(const char *what, std::size_t typeId);
+
+  static inline std::atomic<bool> validation{false};
+
+  std::vector<std::size_t> reads;
+  std::vector<std::size_t> writes;
+  std::vector<std::type_index> _before;
+  std::vector<std::type_index> _after;
+  // creates the declared storages before systems run concurrently
+  std::vector<void (*)(World &)> prepare;
+  bool _declared = false;
+  bool _mainThread = false;
+};
+
+// Per-thread state of the running system: its declaration and the tick of
+// its previous run. Work a system splits across the job system captures it
+// and installs it on whichever thread runs each piece, so validation and
+// change filters there act as on the system's own thread.
+//
+//   SystemContext context = SystemContext::capture();
+//   jobs->parallelFor(0, n, [&](std::size_t begin, std::size_t end) {
+//     SystemContext::Scope scope(context);
+//     ...
+//   });
+struct SystemContext {
+  const SystemAccess *access = nullptr;
+  uint32_t lastRun = 0;
+
+  static SystemContext capture() {
+    return {SystemAccess::current, ChangeTicks::lastRun};
+  }
+
+  // Installs a context on this thread, the previous one is restored on
+  // destruction
+  class Scope {
+  public:
+    explicit Scope(const SystemContext &context) {
+      SystemAccess::current = context.access;
+      ChangeTicks::lastRun = context.lastRun;
+    }
+    ~Scope() {
+      SystemAccess::current = access;
+      ChangeTicks::lastRun = lastRun;
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    const SystemAccess *access = SystemAccess::current;
+    uint32_t lastRun = ChangeTicks::lastRun;
+  };
+};
+
+} // namespace engine
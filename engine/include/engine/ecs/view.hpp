@@ -0,0 +1,524 @@
+#pragma once
+
+#include "engine/core/jobSystem.hpp"
+#include "engine/ecs/component.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace engine {
+
+// View filters: yield T like a plain term, but only for entities whose T was
+// added / mutably accessed since the running system last ran.
+template <typename T> struct Changed {};
+template <typename T> struct Added {};
+
+namespace detail {
+enum class ViewFilter { None, Added, Changed };
+
+template <typename T> struct ViewTerm {
+  using type = T;
+  static constexpr ViewFilter filter = ViewFilter::None;
+};
+template <typename T> struct ViewTerm<Changed<T>> {
+  using type = T;
+  static constexpr ViewFilter filter = ViewFilter::Changed;
+};
+template <typename T> struct ViewTerm<Added<T>> {
+  using type = T;
+  static constexpr ViewFilter filter = ViewFilter::Added;
+};
+} // namespace detail
+
+// Lazy range over every entity that has all of Components. Iterating yields
+// (entity, Components&...) tuples, so structured bindings work:
+//
+//   for (auto [e, transform, camera] : world.view<TransformComponent,
+//                                                 CameraComponent>()) {}
+//
+// A const term (view<const T>) is read-only, every other term marks the
+// component as changed for the entities visited. Changed<T> and Added<T>
+// terms also filter, e.g. view<Changed<const TransformComponent>>().
+//
+// In sparse-set mode the smallest storage drives the loop front to back and
+// the others are probed. In archetype mode matching chunks are walked
+// linearly. Either way components must stay where they are, so adding or
+// removing components and destroying entities throw from begin() until the
+// view is destroyed, and during each() and parEach(). Record them with
+// World::commands() instead.
+//
+// parEach() splits the same walk into ranges of whole cache lines (sparse)
+// or whole chunks (archetype) run on the job system.
+template <typename... Components> class View {
+  static_assert(sizeof...(Components) > 0, "View needs at least one component");
+
+  static constexpr std::size_t Count = sizeof...(Components);
+  template <typename C> using Ref = typename detail::ViewTerm<C>::type &;
+  template <typename C>
+  using Stored = std::remove_const_t<typename detail::ViewTerm<C>::type>;
+  template <std::size_t I>
+  using TermAt =
+      detail::ViewTerm<std::tuple_element_t<I, std::tuple<Components...>>>;
+  template <std::size_t I>
+  static constexpr bool Writes = !std::is_const_v<typename TermAt<I>::type>;
+  // dense index per storage (sparse) or column per component (archetype)
+  using Slots = std::array<uint32_t, Count>;
+  using Columns = std::array<int, Count>;
+
+public:
+  using value_type = std::tuple<Entity, Ref<Components>...>;
+
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = View::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    iterator(View *view, bool atEnd);
+
+    value_type operator*() const;
+    iterator &operator++();
+    bool operator==(const iterator &other) const {
+      return index == other.index && chunk == other.chunk && row == other.row;
+    }
+    bool operator!=(const iterator &other) const { return !(*this == other); }
+
+  private:
+    template <std::size_t... I>
+    value_type archetypeRow(std::index_sequence<I...>) const;
+    template <std::size_t... I>
+    value_type sparseRow(std::index_sequence<I...>) const;
+    void settleSparse();
+    void settleArchetype();
+    void enterArchetype();
+    void stepArchetype();
+
+    View *view;
+    // sparse: position in the driving storage, archetype: archetype being
+    // walked
+    std::size_t index = 0;
+    std::size_t chunk = 0;
+    std::size_t row = 0;
+    Slots slots{};
+    Columns columns{};
+  };
+
+  explicit View(ComponentManager &manager, JobSystem *jobs = nullptr);
+
+  iterator begin() {
+    structureLock.lock(*manager);
+    return iterator(this, false);
+  }
+  iterator end() { return iterator(this, true); }
+
+  // func(Entity, Components&...) or func(Components&...). In sparse-set
+  // mode entities come in the smallest storage's order, the order they were
+  // added in until removals swap some.
+  template <typename Func> void each(Func &&func);
+  // Same as each() but func runs concurrently, in no particular order, on
+  // the job system (serially without one). func may only touch the
+  // components it is handed.
+  template <typename Func> void parEach(Func &&func);
+
+private:
+  // Holds ComponentManager::lockStructure() until destroyed, copies start
+  // out unlocked
+  class StructureLock {
+  public:
+    StructureLock() = default;
+    StructureLock(const StructureLock &) {}
+    StructureLock &operator=(const StructureLock &) { return *this; }
+    ~StructureLock() {
+      if (manager)
+        manager->unlockStructure();
+    }
+    void lock(ComponentManager &target) {
+      if (manager)
+        return;
+      manager = &target;
+      manager->lockStructure();
+    }
+
+  private:
+    ComponentManager *manager = nullptr;
+  };
+
+  template <typename Func, typename... Args>
+  static void invoke(Func &func, Entity entity, Args &&...components);
+  template <typename C> static void checkAccess();
+  template <std::size_t I> bool accepts(uint32_t added, uint32_t changed) const;
+  template <std::size_t I> void touchSlot(uint32_t slot) const;
+  template <std::size_t I> void touchTick(uint32_t &changed) const;
+  template <std::size_t... I>
+  bool fetch(Entity entity, Slots &out, std::index_sequence<I...>) const;
+  template <std::size_t... I>
+  bool acceptsRow(Archetype *archetype, std::size_t chunk, std::size_t row,
+                  const Columns &columns, std::index_sequence<I...>) const;
+  static bool columnsOf(Archetype *archetype, Columns &out);
+  template <typename Func, std::size_t... I>
+  void eachSparse(Func &func, std::size_t begin, std::size_t end,
+                  std::index_sequence<I...>);
+  template <typename Func, std::size_t... I>
+  void eachChunk(Func &func, Archetype *archetype, std::size_t chunk,
+                 const Columns &columns, std::index_sequence<I...>);
+
+  ComponentManager *manager;
+  JobSystem *jobs;
+  const ChangeTicks *ticks;
+  // previous run of the system that created the view
+  uint32_t since;
+  bool archetypeMode;
+  std::tuple<ComponentStorage<Stored<Components>> *...> storages;
+  const std::vector<Entity> *driver = nullptr;
+  // taken by begin()
+  StructureLock structureLock;
+};
+
+template <typename... Components>
+View<Components...>::View(ComponentManager &manager, JobSystem *jobs)
+    : manager(&manager), jobs(jobs), ticks(&manager.getTicks()),
+      since(ChangeTicks::lastRun),
+      archetypeMode(manager.getStorageMode() == StorageMode::Archetype) {
+  (checkAccess<Components>(), ...);
+  if (archetypeMode)
+    return;
+
+  // Looked up, not created: views run on several threads at once, and an
+  // entity can't have a component nothing has stored yet
+  storages = std::make_tuple(manager.findStorage<Stored<Components>>()...);
+  static const std::vector<Entity> none;
+  driver = &none;
+  bool complete = std::apply(
+      [](auto *...storage) { return ((storage != nullptr) && ...); },
+      storages);
+  if (!complete)
+    return;
+
+  std::size_t smallest = ~std::size_t(0);
+  auto consider = [&](auto *storage) {
+    if (storage->size() < smallest) {
+      smallest = storage->size();
+      driver = &storage->entities();
+    }
+  };
+  std::apply([&](auto *...storage) { (consider(storage), ...); }, storages);
+}
+
+template <typename... Components>
+template <typename C>
+void View<Components...>::checkAccess() {
+  if constexpr (std::is_const_v<typename detail::ViewTerm<C>::type>)
+    SystemAccess::checkRead(ComponentTypeId::get<Stored<C>>());
+  else
+    SystemAccess::checkWrite(ComponentTypeId::get<Stored<C>>());
+}
+
+template <typename... Components>
+template <std::size_t I>
+bool View<Components...>::accepts(uint32_t added, uint32_t changed) const {
+  if constexpr (TermAt<I>::filter == detail::ViewFilter::Added)
+    return added > since;
+  else if constexpr (TermAt<I>::filter == detail::ViewFilter::Changed)
+    return changed > since;
+  else
+    return true;
+}
+
+template <typename... Components>
+template <std::size_t I>
+void View<Components...>::touchSlot(uint32_t slot) const {
+  if constexpr (Writes<I>)
+    std::get<I>(storages)->touch(slot);
+}
+
+template <typename... Components>
+template <std::size_t I>
+void View<Components...>::touchTick(uint32_t &changed) const {
+  if constexpr (Writes<I>)
+    changed = ticks->current;
+}
+
+template <typename... Components>
+template <std::size_t... I>
+bool View<Components...>::fetch(Entity entity, Slots &out,
+                                std::index_sequence<I...>) const {
+  return (((out[I] = std::get<I>(storages)->indexOf(entity)) !=
+           ComponentStorage<Stored<Components>>::Null) &&
+          ...) &&
+         (accepts<I>(std::get<I>(storages)->addedTick(out[I]),
+                     std::get<I>(storages)->changedTick(out[I])) &&
+          ...);
+}
+
+template <typename... Components>
+template <std::size_t... I>
+bool View<Components...>::acceptsRow(Archetype *archetype, std::size_t chunk,
+                                     std::size_t row, const Columns &columns,
+                                     std::index_sequence<I...>) const {
+  return (accepts<I>(archetype->addedTicks(chunk, columns[I])[row],
+                     archetype->changedTicks(chunk, columns[I])[row]) &&
+          ...);
+}
+
+template <typename... Components>
+bool View<Components...>::columnsOf(Archetype *archetype, Columns &out) {
+  std::size_t i = 0;
+  return (((out[i++] = archetype->columnOf(
+                ComponentInfo::of<Stored<Components>>())) >= 0) &&
+          ...);
+}
+
+template <typename... Components>
+template <typename Func, typename... Args>
+void View<Components...>::invoke(Func &func, Entity entity,
+                                 Args &&...components) {
+  if constexpr (std::is_invocable_v<Func &, Entity, Ref<Components>...>)
+    func(entity, std::forward<Args>(components)...);
+  else
+    func(std::forward<Args>(components)...);
+}
+
+template <typename... Components>
+template <typename Func, std::size_t... I>
+void View<Components...>::eachSparse(Func &func, std::size_t begin,
+                                     std::size_t end,
+                                     std::index_sequence<I...>) {
+  Slots slots;
+  for (std::size_t i = begin; i < end; ++i) {
+    Entity entity = (*driver)[i];
+    if (!fetch(entity, slots, std::index_sequence<I...>{}))
+      continue;
+    (touchSlot<I>(slots[I]), ...);
+    invoke(func, entity,
+           static_cast<Ref<Components>>(std::get<I>(storages)->at(slots[I]))...);
+  }
+}
+
+template <typename... Components>
+template <typename Func, std::size_t... I>
+void View<Components...>::eachChunk(Func &func, Archetype *archetype,
+                                    std::size_t chunk, const Columns &columns,
+                                    std::index_sequence<I...>) {
+  Entity *entities = archetype->entities(chunk);
+  std::tuple<Stored<Components> *...> data{
+      archetype->template columnData<Stored<Components>>(chunk, columns[I])...};
+  std::array<uint32_t *, Count> added{
+      archetype->addedTicks(chunk, columns[I])...};
+  std::array<uint32_t *, Count> changed{
+      archetype->changedTicks(chunk, columns[I])...};
+  std::size_t count = archetype->chunkSize(chunk);
+  for (std::size_t r = 0; r < count; ++r) {
+    if (!(accepts<I>(added[I][r], changed[I][r]) && ...))
+      continue;
+    (touchTick<I>(changed[I][r]), ...);
+    invoke(func, entities[r],
+           static_cast<Ref<Components>>(std::get<I>(data)[r])...);
+  }
+}
+
+template <typename... Components>
+template <typename Func>
+void View<Components...>::each(Func &&func) {
+  StructureLock lock;
+  lock.lock(*manager);
+  if (!archetypeMode) {
+    eachSparse(func, 0, driver->size(),
+               std::index_sequence_for<Components...>{});
+    return;
+  }
+
+  Columns columns;
+  for (Archetype *archetype : manager->getArchetypeStorage().getArchetypes()) {
+    if (!archetype->size() || !columnsOf(archetype, columns))
+      continue;
+    for (std::size_t c = 0; c < archetype->chunkCount(); ++c)
+      eachChunk(func, archetype, c, columns,
+                std::index_sequence_for<Components...>{});
+  }
+}
+
+template <typename... Components>
+template <typename Func>
+void View<Components...>::parEach(Func &&func) {
+  if (!jobs || jobs->threadCount() == 1) {
+    each(func);
+    return;
+  }
+
+  StructureLock lock;
+  lock.lock(*manager);
+
+  // ranges run on other threads validate and filter as this one does
+  SystemContext context = SystemContext::capture();
+  std::exception_ptr error;
+  std::mutex errorMutex;
+  auto guarded = [&](auto &&body) {
+    SystemContext::Scope scope(context);
+    try {
+      body();
+    } catch (...) {
+      std::lock_guard<std::mutex> guard(errorMutex);
+      if (!error)
+        error = std::current_exception();
+    }
+  };
+
+  if (!archetypeMode) {
+    // Ranges are multiples of 64 slots, so every component page (64-byte
+    // aligned) is split on cache line boundaries
+    constexpr std::size_t Line = 64;
+    std::size_t count = driver->size();
+    std::size_t grain = count / (jobs->threadCount() * 4);
+    grain = std::max(Line, (grain + Line - 1) / Line * Line);
+    jobs->parallelFor(
+        0, count,
+        [&](std::size_t begin, std::size_t end) {
+          guarded([&] {
+            eachSparse(func, begin, end,
+                       std::index_sequence_for<Components...>{});
+          });
+        },
+        grain);
+  } else {
+    struct Work {
+      Archetype *archetype;
+      std::size_t chunk;
+      Columns columns;
+    };
+    std::vector<Work> work;
+    Columns columns;
+    for (Archetype *archetype :
+         manager->getArchetypeStorage().getArchetypes()) {
+      if (!archetype->size() || !columnsOf(archetype, columns))
+        continue;
+      for (std::size_t c = 0; c < archetype->chunkCount(); ++c)
+        work.push_back({archetype, c, columns});
+    }
+    jobs->parallelFor(
+        0, work.size(),
+        [&](std::size_t begin, std::size_t end) {
+          guarded([&] {
+            for (std::size_t i = begin; i < end; ++i)
+              eachChunk(func, work[i].archetype, work[i].chunk,
+                        work[i].columns,
+                        std::index_sequence_for<Components...>{});
+          });
+        },
+        1);
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
+//ITERATOR
+template <typename... Components>
+View<Components...>::iterator::iterator(View *view, bool atEnd) : view(view) {
+  if (view->archetypeMode) {
+    index = atEnd ? view->manager->getArchetypeStorage().getArchetypes().size()
+                  : 0;
+    enterArchetype();
+    settleArchetype();
+  } else {
+    index = atEnd ? view->driver->size() : 0;
+    settleSparse();
+  }
+}
+
+template <typename... Components>
+void View<Components...>::iterator::settleSparse() {
+  const std::vector<Entity> &entities = *view->driver;
+  while (index < entities.size() &&
+         !view->fetch(entities[index], slots,
+                      std::index_sequence_for<Components...>{}))
+    ++index;
+}
+
+template <typename... Components>
+void View<Components...>::iterator::enterArchetype() {
+  const auto &archetypes = view->manager->getArchetypeStorage().getArchetypes();
+  chunk = 0;
+  row = 0;
+  while (index < archetypes.size() &&
+         !(archetypes[index]->size() && columnsOf(archetypes[index], columns)))
+    ++index;
+}
+
+template <typename... Components>
+void View<Components...>::iterator::stepArchetype() {
+  Archetype *archetype =
+      view->manager->getArchetypeStorage().getArchetypes()[index];
+  if (++row == archetype->chunkSize(chunk)) {
+    row = 0;
+    if (++chunk == archetype->chunkCount()) {
+      ++index;
+      enterArchetype();
+    }
+  }
+}
+
+template <typename... Components>
+void View<Components...>::iterator::settleArchetype() {
+  const auto &archetypes = view->manager->getArchetypeStorage().getArchetypes();
+  while (index < archetypes.size() &&
+         !view->acceptsRow(archetypes[index], chunk, row, columns,
+                           std::index_sequence_for<Components...>{}))
+    stepArchetype();
+}
+
+template <typename... Components>
+typename View<Components...>::iterator &
+View<Components...>::iterator::operator++() {
+  if (view->archetypeMode) {
+    stepArchetype();
+    settleArchetype();
+  } else {
+    ++index;
+    settleSparse();
+  }
+  return *this;
+}
+
+template <typename... Components>
+template <std::size_t... I>
+typename View<Components...>::value_type
+View<Components...>::iterator::archetypeRow(std::index_sequence<I...>) const {
+  Archetype *archetype =
+      view->manager->getArchetypeStorage().getArchetypes()[index];
+  (view->template touchTick<I>(archetype->changedTicks(chunk, columns[I])[row]),
+   ...);
+  return value_type(archetype->entities(chunk)[row],
+                    static_cast<Ref<Components>>(
+                        archetype->template columnData<Stored<Components>>(
+                            chunk, columns[I])[row])...);
+}
+
+template <typename... Components>
+template <std::size_t... I>
+typename View<Components...>::value_type
+View<Components...>::iterator::sparseRow(std::index_sequence<I...>) const {
+  (view->template touchSlot<I>(slots[I]), ...);
+  return value_type((*view->driver)[index],
+                    static_cast<Ref<Components>>(
+                        std::get<I>(view->storages)->at(slots[I]))...);
+}
+
+template <typename... Components>
+typename View<Components...>::value_type
+View<Components...>::iterator::operator*() const {
+  if (view->archetypeMode)
+    return archetypeRow(std::index_sequence_for<Components...>{});
+  return sparseRow(std::index_sequence_for<Components...>{});
+}
+
+} // namespace engine
@@ -1,7 +1,9 @@
 #pragma once
 #include "engine/assets/mesh.hpp"
 #include "engine/components/components.hpp"
+#include "engine/core/jobSystem.hpp"
 #include "engine/core/world.hpp"
+#include "engine/ecs/commandBuffer.hpp"
 #include "engine/ecs/component.hpp"
 #include "engine/ecs/system.hpp"
 #include "engine/engineContext.hpp"
@@ -19,7 +21,7 @@ namespace engine {
 using Entity = uint32_t;
 class Engine {
 public:
-  Engine();
+  explicit Engine(StorageMode storageMode = StorageMode::SparseSet);
   ~Engine();
 
   void init(int width, int height, const char *title);
@@ -33,6 +35,7 @@ private:
   World _world;
   Renderer *renderer;
   Controller *controller = nullptr;
+  JobSystem *jobs = nullptr;
   InputManager inputManager;
   EngineContext *context;
   bool _running = true;
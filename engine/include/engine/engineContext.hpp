@@ -4,8 +4,11 @@
 namespace engine{
 struct Controller;
 struct Renderer;
+class JobSystem;
 
 struct EngineContext {
   Controller *controller = nullptr;
+  // shared worker pool, use it instead of spawning threads
+  JobSystem *jobs = nullptr;
 };
 }
@@ -22,6 +22,40 @@ inline void updateCameraBasis(const Vec3 &rotation, Vec3 &forward, Vec3 &right,
   up = up.normalized();
 }
 
+// Basis of a camera rotated by q, looking along its local +Z
+inline void updateCameraBasis(const Quat &q, Vec3 &forward, Vec3 &right,
+                              Vec3 &up) {
+  forward = q.rotate(Vec3(0, 0, 1));
+  right = q.rotate(Vec3(1, 0, 0));
+  up = q.rotate(Vec3(0, 1, 0));
+}
+
+// View matrix of a camera placed by its world matrix (scale is ignored). The
+// camera looks along its local +Z, which maps to -Z in view space.
+inline Mat4 viewFromWorld(const Mat4 &world) {
+  Vec3 eye(world[3][0], world[3][1], world[3][2]);
+  Vec3 forward = Vec3(world[2][0], world[2][1], world[2][2]).normalized();
+  Vec3 right =
+      Vec3(world[1][0], world[1][1], world[1][2]).cross(forward).normalized();
+  Vec3 up = forward.cross(right);
+
+  Mat4 vm{};
+  vm[0][0] = right.x;
+  vm[1][0] = right.y;
+  vm[2][0] = right.z;
+  vm[3][0] = -1 * right.dot(eye);
+  vm[0][1] = up.x;
+  vm[1][1] = up.y;
+  vm[2][1] = up.z;
+  vm[3][1] = -1 * up.dot(eye);
+  vm[0][2] = -forward.x;
+  vm[1][2] = -forward.y;
+  vm[2][2] = -forward.z;
+  vm[3][2] = forward.dot(eye);
+
+  return vm;
+}
+
 inline Vec3 extractPosition(const Mat4 &m) {
   return Vec3(m[3][0], m[3][1], m[3][2]);
 }
@@ -52,11 +86,36 @@ inline Vec3 extractRotationEuler(const Mat4 &m) {
   return Vec3(pitch, yaw, roll);
 }
 
+// Rotation part of a TRS matrix
+inline Quat extractRotation(const Mat4 &m) {
+  Vec3 c0 = Vec3(m[0][0], m[0][1], m[0][2]).normalized();
+  Vec3 c1 = Vec3(m[1][0], m[1][1], m[1][2]).normalized();
+  Vec3 c2 = Vec3(m[2][0], m[2][1], m[2][2]).normalized();
+
+  // largest of w, x, y, z first, for precision
+  float trace = c0.x + c1.y + c2.z;
+  Quat q;
+  if (trace > 0) {
+    float s = std::sqrt(trace + 1) * 2;
+    q = Quat((c1.z - c2.y) / s, (c2.x - c0.z) / s, (c0.y - c1.x) / s, s / 4);
+  } else if (c0.x > c1.y && c0.x > c2.z) {
+    float s = std::sqrt(1 + c0.x - c1.y - c2.z) * 2;
+    q = Quat(s / 4, (c1.x + c0.y) / s, (c2.x + c0.z) / s, (c1.z - c2.y) / s);
+  } else if (c1.y > c2.z) {
+    float s = std::sqrt(1 + c1.y - c0.x - c2.z) * 2;
+    q = Quat((c1.x + c0.y) / s, s / 4, (c2.y + c1.z) / s, (c2.x - c0.z) / s);
+  } else {
+    float s = std::sqrt(1 + c2.z - c0.x - c1.y) * 2;
+    q = Quat((c2.x + c0.z) / s, (c2.y + c1.z) / s, s / 4, (c0.y - c1.x) / s);
+  }
+  return q.normalized();
+}
+
 inline TransformComponent transformFromMatrix(const Mat4 &m) {
   TransformComponent t;
   t.position = extractPosition(m);
   t.scale = extractScale(m);
-  t.rotation = extractRotationEuler(m);
+  t.rotation = extractRotation(m);
   return t;
 }
 
@@ -1,18 +1,24 @@
 #pragma once
 
+#include "engine/math/quat.hpp"
+#include "engine/math/simd.hpp"
 #include "engine/math/vec4.hpp"
 #include <cmath>
   
 namespace engine {
 struct TransformComponent;
-struct Mat4 {
+struct alignas(16) Mat4 {
   float m[4][4]; // column-major: m[column][row]
 
-  Mat4(); // identity mat
+  Mat4() { // identity mat
+    for (int c = 0; c < 4; c++)
+      for (int r = 0; r < 4; r++)
+        m[c][r] = (c == r) ? 1.0f : 0.0f;
+  }
 
   // Access: m[col][row]
-  float *operator[](int col);
-  const float *operator[](int col) const;
+  float *operator[](int col) { return m[col]; }
+  const float *operator[](int col) const { return m[col]; }
 
   // Matrix × Matrix
   Mat4 operator*(const Mat4 &rhs) const;
@@ -23,8 +29,10 @@ struct Mat4 {
   // Transpose
   Mat4 transpose() const;
 
-  Vec4 getRow(int r) const;
-  Vec4 getCol(int c) const;
+  Vec4 getRow(int r) const {
+    return Vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+  }
+  Vec4 getCol(int c) const { return Vec4(m[c][0], m[c][1], m[c][2], m[c][3]); }
 
   // Static factory methods
   static Mat4 identity() { return Mat4(); }
@@ -79,6 +87,33 @@ struct Mat4 {
     return rotateZ(r.z) * rotateY(r.y) * rotateX(r.x);
   }
 
+  static Mat4 rotation(const Quat &q) {
+    return trs(Vec3(0, 0, 0), q, Vec3(1, 1, 1));
+  }
+
+  // translate(t) * rotation(q) * scale(s), filled in directly
+  static Mat4 trs(const Vec3 &t, const Quat &q, const Vec3 &s) {
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+    Mat4 mm{};
+    mm[0][0] = (1 - 2 * (yy + zz)) * s.x;
+    mm[0][1] = 2 * (xy + wz) * s.x;
+    mm[0][2] = 2 * (xz - wy) * s.x;
+    mm[1][0] = 2 * (xy - wz) * s.y;
+    mm[1][1] = (1 - 2 * (xx + zz)) * s.y;
+    mm[1][2] = 2 * (yz + wx) * s.y;
+    mm[2][0] = 2 * (xz + wy) * s.z;
+    mm[2][1] = 2 * (yz - wx) * s.z;
+    mm[2][2] = (1 - 2 * (xx + yy)) * s.z;
+    mm[3][0] = t.x;
+    mm[3][1] = t.y;
+    mm[3][2] = t.z;
+
+    return mm;
+  }
+
   static Mat4 modelMatrix(const TransformComponent &transform); 
 
   static Mat4 perspective(float fov, float aspect, float near, float far) {
@@ -122,4 +157,68 @@ struct Mat4 {
     return vm;
   }
 };
+
+// Column c of a product is the sum of this matrix's columns weighted by
+// rhs column c, accumulated column 0 first as the scalar dot products are
+inline Mat4 Mat4::operator*(const Mat4 &rhs) const {
+  Mat4 nm;
+#if defined(ENGINE_MATH_AVX)
+  // two result columns per 256-bit register
+  __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(m[0]));
+  __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(m[1]));
+  __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(m[2]));
+  __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(m[3]));
+  for (int c = 0; c < 4; c += 2) {
+    __m256 b = _mm256_loadu_ps(rhs.m[c]);
+    __m256 sum = _mm256_mul_ps(a0, _mm256_permute_ps(b, 0x00));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(a1, _mm256_permute_ps(b, 0x55)));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(a2, _mm256_permute_ps(b, 0xAA)));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(a3, _mm256_permute_ps(b, 0xFF)));
+    _mm256_storeu_ps(nm.m[c], sum);
+  }
+#elif defined(ENGINE_MATH_SSE)
+  __m128 a0 = _mm_load_ps(m[0]);
+  __m128 a1 = _mm_load_ps(m[1]);
+  __m128 a2 = _mm_load_ps(m[2]);
+  __m128 a3 = _mm_load_ps(m[3]);
+  for (int c = 0; c < 4; c++) {
+    __m128 b = _mm_load_ps(rhs.m[c]);
+    __m128 sum = _mm_mul_ps(a0, _mm_shuffle_ps(b, b, 0x00));
+    sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_shuffle_ps(b, b, 0x55)));
+    sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_shuffle_ps(b, b, 0xAA)));
+    sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_shuffle_ps(b, b, 0xFF)));
+    _mm_store_ps(nm.m[c], sum);
+  }
+#else
+  for (int c = 0; c < 4; c++)
+    for (int r = 0; r < 4; r++)
+      nm.m[c][r] = m[0][r] * rhs.m[c][0] + m[1][r] * rhs.m[c][1] +
+                   m[2][r] * rhs.m[c][2] + m[3][r] * rhs.m[c][3];
+#endif
+  return nm;
+}
+
+inline Vec4 Mat4::operator*(const Vec4 &v) const {
+#if defined(ENGINE_MATH_SSE)
+  __m128 sum = _mm_mul_ps(_mm_load_ps(m[0]), _mm_set1_ps(v.x));
+  sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(m[1]), _mm_set1_ps(v.y)));
+  sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(m[2]), _mm_set1_ps(v.z)));
+  sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(m[3]), _mm_set1_ps(v.w)));
+  return Vec4::fromSimd(sum);
+#else
+  Vec4 result;
+  for (int r = 0; r < 4; r++)
+    result[r] = m[0][r] * v.x + m[1][r] * v.y + m[2][r] * v.z + m[3][r] * v.w;
+  return result;
+#endif
+}
+
+inline Mat4 Mat4::transpose() const {
+  Mat4 nm;
+  for (int c = 0; c < 4; c++)
+    for (int r = 0; r < 4; r++)
+      nm[c][r] = m[r][c];
+
+  return nm;
+}
 } // namespace engine
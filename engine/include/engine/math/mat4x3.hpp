@@ -0,0 +1,131 @@
+#pragma once
+#include "engine/math/mat4.hpp"
+#include "engine/math/vec3.hpp"
+
+namespace engine {
+// Affine transform, a Mat4 whose bottom row is implicitly (0, 0, 0, 1)
+struct Mat4x3 {
+  float m[4][3]; // column-major: m[column][row], m[3] is the translation
+
+  Mat4x3() { // identity mat
+    for (int c = 0; c < 4; c++)
+      for (int r = 0; r < 3; r++)
+        m[c][r] = (c == r) ? 1.0f : 0.0f;
+  }
+  // Drops the bottom row of mat
+  explicit Mat4x3(const Mat4 &mat) {
+    for (int c = 0; c < 4; c++)
+      for (int r = 0; r < 3; r++)
+        m[c][r] = mat[c][r];
+  }
+
+  // Access: m[col][row]
+  float *operator[](int col) { return m[col]; }
+  const float *operator[](int col) const { return m[col]; }
+
+  Mat4 toMat4() const;
+  Vec3 column(int c) const { return Vec3(m[c][0], m[c][1], m[c][2]); }
+
+  // Applies rhs first, then this
+  Mat4x3 operator*(const Mat4x3 &rhs) const;
+  Vec3 transformPoint(const Vec3 &p) const;
+  // Ignores the translation
+  Vec3 transformVector(const Vec3 &v) const;
+
+  // Inverse through the cofactors of the linear part, which must be
+  // invertible
+  Mat4x3 inverse() const;
+  // Inverse-transpose of the linear part (no translation), maps normals
+  Mat4x3 normalMatrix() const;
+
+  // Cheaper versions for matrices with orthogonal columns, that is rotation
+  // and scale without shear: the inverse of R * S is S^-2 * (R * S)^T
+  Mat4x3 inverseOrthogonal() const;
+  Mat4x3 normalMatrixOrthogonal() const;
+
+  static Mat4x3 identity() { return Mat4x3(); }
+};
+
+inline Mat4 Mat4x3::toMat4() const {
+  Mat4 mat;
+  for (int c = 0; c < 4; c++)
+    for (int r = 0; r < 3; r++)
+      mat[c][r] = m[c][r];
+  return mat;
+}
+
+inline Mat4x3 Mat4x3::operator*(const Mat4x3 &rhs) const {
+  Mat4x3 nm;
+  for (int c = 0; c < 4; c++) {
+    for (int r = 0; r < 3; r++)
+      nm[c][r] = m[0][r] * rhs[c][0] + m[1][r] * rhs[c][1] +
+                 m[2][r] * rhs[c][2] + (c == 3 ? m[3][r] : 0.0f);
+  }
+  return nm;
+}
+
+inline Vec3 Mat4x3::transformPoint(const Vec3 &p) const {
+  return Vec3(m[0][0] * p.x + m[1][0] * p.y + m[2][0] * p.z + m[3][0],
+              m[0][1] * p.x + m[1][1] * p.y + m[2][1] * p.z + m[3][1],
+              m[0][2] * p.x + m[1][2] * p.y + m[2][2] * p.z + m[3][2]);
+}
+
+inline Vec3 Mat4x3::transformVector(const Vec3 &v) const {
+  return Vec3(m[0][0] * v.x + m[1][0] * v.y + m[2][0] * v.z,
+              m[0][1] * v.x + m[1][1] * v.y + m[2][1] * v.z,
+              m[0][2] * v.x + m[1][2] * v.y + m[2][2] * v.z);
+}
+
+inline Mat4x3 Mat4x3::normalMatrix() const {
+  // The rows of the inverse of [a b c] are (b x c, c x a, a x b) / det, so
+  // those are the columns of its transpose
+  Vec3 a = column(0), b = column(1), c = column(2);
+  Vec3 bc = b.cross(c), ca = c.cross(a), ab = a.cross(b);
+  float invDet = 1.0f / a.dot(bc);
+
+  Mat4x3 nm;
+  const Vec3 cols[3] = {bc * invDet, ca * invDet, ab * invDet};
+  for (int col = 0; col < 3; col++) {
+    nm[col][0] = cols[col].x;
+    nm[col][1] = cols[col].y;
+    nm[col][2] = cols[col].z;
+  }
+  nm[3][0] = nm[3][1] = nm[3][2] = 0.0f;
+  return nm;
+}
+
+inline Mat4x3 Mat4x3::normalMatrixOrthogonal() const {
+  Mat4x3 nm;
+  for (int c = 0; c < 3; c++) {
+    float lengthSq = column(c).dot(column(c));
+    for (int r = 0; r < 3; r++)
+      nm[c][r] = m[c][r] / lengthSq;
+  }
+  nm[3][0] = nm[3][1] = nm[3][2] = 0.0f;
+  return nm;
+}
+
+namespace detail {
+// The transpose of a normal matrix with the translation moved through it
+inline Mat4x3 inverseFromNormalMatrix(const Mat4x3 &normal,
+                                      const Vec3 &translation) {
+  Mat4x3 inv;
+  for (int c = 0; c < 3; c++)
+    for (int r = 0; r < 3; r++)
+      inv[c][r] = normal[r][c];
+  Vec3 t = inv.transformVector(translation);
+  inv[3][0] = -t.x;
+  inv[3][1] = -t.y;
+  inv[3][2] = -t.z;
+  return inv;
+}
+} // namespace detail
+
+inline Mat4x3 Mat4x3::inverse() const {
+  return detail::inverseFromNormalMatrix(normalMatrix(), column(3));
+}
+
+inline Mat4x3 Mat4x3::inverseOrthogonal() const {
+  return detail::inverseFromNormalMatrix(normalMatrixOrthogonal(), column(3));
+}
+} // namespace engine
@@ -0,0 +1,73 @@
+#pragma once
+#include "engine/math/vec3.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace engine {
+// Unit quaternion rotation
+struct Quat {
+  float x, y, z, w;
+
+  Quat() : x(0), y(0), z(0), w(1) {} // identity
+  Quat(float x_, float y_, float z_, float w_)
+      : x(x_), y(y_), z(z_), w(w_) {}
+
+  // Applies rhs first, then this
+  Quat operator*(const Quat &rhs) const;
+  Vec3 rotate(const Vec3 &v) const;
+  Quat normalized() const;
+  Quat conjugate() const;
+
+  static Quat identity() { return Quat(); }
+  static Quat fromAxisAngle(const Vec3 &axis, float angle);
+  // Euler angles in radians applied X, then Y, then Z (the order of
+  // Mat4::rotationXYZ)
+  static Quat fromEuler(const Vec3 &euler);
+  Vec3 toEuler() const;
+};
+
+inline Quat Quat::operator*(const Quat &q) const {
+  return Quat(w * q.x + x * q.w + y * q.z - z * q.y,
+              w * q.y - x * q.z + y * q.w + z * q.x,
+              w * q.z + x * q.y - y * q.x + z * q.w,
+              w * q.w - x * q.x - y * q.y - z * q.z);
+}
+
+inline Vec3 Quat::rotate(const Vec3 &v) const {
+  // v + 2w(u x v) + 2u x (u x v)
+  Vec3 u(x, y, z);
+  Vec3 t = u.cross(v) * 2.0f;
+  return v + t * w + u.cross(t);
+}
+
+inline Quat Quat::normalized() const {
+  float len = std::sqrt(x * x + y * y + z * z + w * w);
+  if (len == 0)
+    return Quat();
+  return Quat(x / len, y / len, z / len, w / len);
+}
+
+inline Quat Quat::conjugate() const { return Quat(-x, -y, -z, w); }
+
+inline Quat Quat::fromAxisAngle(const Vec3 &axis, float angle) {
+  Vec3 a = axis.normalized() * std::sin(angle / 2);
+  return Quat(a.x, a.y, a.z, std::cos(angle / 2));
+}
+
+inline Quat Quat::fromEuler(const Vec3 &e) {
+  float cx = std::cos(e.x / 2), sx = std::sin(e.x / 2);
+  float cy = std::cos(e.y / 2), sy = std::sin(e.y / 2);
+  float cz = std::cos(e.z / 2), sz = std::sin(e.z / 2);
+
+  // z * y * x
+  return Quat(sx * cy * cz - cx * sy * sz, cx * sy * cz + sx * cy * sz,
+              cx * cy * sz - sx * sy * cz, cx * cy * cz + sx * sy * sz);
+}
+
+inline Vec3 Quat::toEuler() const {
+  float ex = std::atan2(2 * (w * x + y * z), 1 - 2 * (x * x + y * y));
+  float ey = std::asin(std::clamp(2 * (w * y - x * z), -1.0f, 1.0f));
+  float ez = std::atan2(2 * (w * z + x * y), 1 - 2 * (y * y + z * z));
+  return Vec3(ex, ey, ez);
+}
+} // namespace engine
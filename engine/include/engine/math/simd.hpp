@@ -0,0 +1,15 @@
+#pragma once
+
+// Math backend, chosen at compile time from the target flags: SSE for Vec4
+// and Mat4 columns (always available on x86-64), AVX for two Mat4 columns at
+// a time when built with -mavx/-mavx2. Define ENGINE_MATH_SCALAR to force the
+// portable code. All backends multiply and add in the same order and never
+// fuse multiply-adds, so they produce the same floats.
+#if !defined(ENGINE_MATH_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+#define ENGINE_MATH_SSE 1
+#include <emmintrin.h>
+#if defined(__AVX__)
+#define ENGINE_MATH_AVX 1
+#include <immintrin.h>
+#endif
+#endif
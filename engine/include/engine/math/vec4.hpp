@@ -1,15 +1,17 @@
-
 #pragma once
+#include "engine/math/simd.hpp"
 #include "engine/math/vec3.hpp"
 #include <cmath>
+#include <stdexcept>
 
 namespace engine {
-struct Vec4 {
+struct alignas(16) Vec4 {
   float x, y, z, w;
 
-  Vec4();
-  Vec4(float x_, float y_, float z_, float w_ = 1.0f);
-  Vec4(Vec3 v3, float w=0);
+  Vec4() : x(0), y(0), z(0), w(1.0f) {}
+  Vec4(float x_, float y_, float z_, float w_ = 1.0f)
+      : x(x_), y(y_), z(z_), w(w_) {}
+  Vec4(Vec3 v3, float w_ = 0) : x(v3.x), y(v3.y), z(v3.z), w(w_) {}
 
   float &operator[](int col);
   const float &operator[](int index) const;
@@ -17,7 +19,79 @@ struct Vec4 {
   Vec4 operator+(const Vec4 &v) const;
   Vec4 operator-(const Vec4 &v) const;
   Vec4 operator*(float s) const;
-  Vec3 toVec3();
-  float dot(const Vec4 &rhs) const;
+  // Divides by w unless it is 0
+  Vec3 toVec3() const;
+  float dot(const Vec4 &rhs) const {
+    return x * rhs.x + y * rhs.y + z * rhs.z + w * rhs.w;
+  }
+
+#ifdef ENGINE_MATH_SSE
+  __m128 simd() const { return _mm_load_ps(&x); }
+  static Vec4 fromSimd(__m128 v) {
+    Vec4 r;
+    _mm_store_ps(&r.x, v);
+    return r;
+  }
+#endif
 };
+
+inline Vec4 Vec4::operator+(const Vec4 &v) const {
+#ifdef ENGINE_MATH_SSE
+  return fromSimd(_mm_add_ps(simd(), v.simd()));
+#else
+  return Vec4(x + v.x, y + v.y, z + v.z, w + v.w);
+#endif
+}
+
+inline Vec4 Vec4::operator-(const Vec4 &v) const {
+#ifdef ENGINE_MATH_SSE
+  return fromSimd(_mm_sub_ps(simd(), v.simd()));
+#else
+  return Vec4(x - v.x, y - v.y, z - v.z, w - v.w);
+#endif
+}
+
+inline Vec4 Vec4::operator*(float s) const {
+#ifdef ENGINE_MATH_SSE
+  return fromSimd(_mm_mul_ps(simd(), _mm_set1_ps(s)));
+#else
+  return Vec4(x * s, y * s, z * s, w * s);
+#endif
+}
+
+inline Vec3 Vec4::toVec3() const {
+  if (w == 0.0f)
+    return Vec3(x, y, z);
+  return Vec3(x / w, y / w, z / w);
+}
+
+inline float &Vec4::operator[](int col) {
+  switch (col) {
+  case 0:
+    return x;
+  case 1:
+    return y;
+  case 2:
+    return z;
+  case 3:
+    return w;
+  default:
+    throw std::out_of_range("Vec4 index out of range");
+  }
+}
+
+inline const float &Vec4::operator[](int index) const {
+  switch (index) {
+  case 0:
+    return x;
+  case 1:
+    return y;
+  case 2:
+    return z;
+  case 3:
+    return w;
+  default:
+    throw std::out_of_range("Vec4 index out of range");
+  }
+}
 } // namespace engine
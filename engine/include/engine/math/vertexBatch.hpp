@@ -0,0 +1,60 @@
+#pragma once
+#include "engine/math/mat4.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace engine::math {
+
+// Frustum planes a clip-space position is outside of, -w <= x, y, z <= w is
+// inside
+enum Outcode : uint8_t {
+  OutLeft = 1,
+  OutRight = 2,
+  OutBottom = 4,
+  OutTop = 8,
+  OutNear = 16,
+  OutFar = 32,
+};
+
+// Clip-space positions of a batch of vertices, one array per component
+struct ClipVertices {
+  std::vector<float> x, y, z, w;
+  std::vector<uint8_t> outcodes;
+
+  void resize(std::size_t count) {
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    w.resize(count);
+    outcodes.resize(count);
+  }
+  std::size_t size() const { return x.size(); }
+};
+
+// Screen-space positions of a batch of vertices: x, y in pixels, z the NDC
+// depth
+struct ScreenVertices {
+  std::vector<float> x, y, z;
+
+  void resize(std::size_t count) {
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+  }
+  std::size_t size() const { return x.size(); }
+};
+
+// out[i] = m * (x[i], y[i], z[i], 1) for count positions, plus their
+// outcodes. 8 (AVX) or 4 (SSE) vertices per step, the results match
+// Mat4 * Vec4 exactly. out must already hold count vertices.
+void transformPositions(const Mat4 &m, const float *x, const float *y,
+                        const float *z, std::size_t count, ClipVertices &out);
+
+// Perspective divide and viewport transform of every vertex in clip, the
+// same floats as Renderer::project. Vertices with w <= 0 (behind the eye)
+// become (-1, -1, -1). out must already hold clip.size() vertices.
+void projectToScreen(const ClipVertices &clip, float width, float height,
+                     ScreenVertices &out);
+
+} // namespace engine::math
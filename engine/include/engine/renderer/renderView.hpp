@@ -0,0 +1,37 @@
+#pragma once
+#include "engine/math/mat4.hpp"
+#include "engine/math/vec3.hpp"
+#include "engine/math/vec4.hpp"
+
+namespace engine {
+
+// Camera state shared by every draw of a frame, built once by
+// Renderer::prepareView
+struct RenderView {
+  Mat4 view;
+  Mat4 projection;
+  Mat4 viewProjection; // projection * view
+
+  Vec3 cameraPos;
+  Vec3 forward; // camera's local +Z in world space
+
+  // World space planes (a, b, c, d) facing inwards: left, right, bottom, top,
+  // near, far. A point p is inside a plane when a*x + b*y + c*z + d >= 0.
+  Vec4 frustum[6];
+
+  // Renderer::lightDir in view space, normalized
+  Vec3 lightDirView;
+
+  // False when the sphere lies entirely outside one of the frustum planes
+  bool sphereVisible(const Vec3 &center, float radius) const {
+    for (const Vec4 &plane : frustum) {
+      if (plane.x * center.x + plane.y * center.y + plane.z * center.z +
+              plane.w <
+          -radius)
+        return false;
+    }
+    return true;
+  }
+};
+
+} // namespace engine
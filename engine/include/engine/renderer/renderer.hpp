@@ -11,16 +11,41 @@
 #include "engine/input/controller.hpp"
 #include "engine/math/vec3.hpp"
 #include "engine/math/vec4.hpp"
+#include "engine/math/vertexBatch.hpp"
+#include "engine/renderer/renderView.hpp"
  
 namespace engine {
 
+class JobSystem;
+
+// How the raster phase colors pixels. Forward shades every pixel that passes
+// the depth test as it is drawn. Visibility only records the depth and
+// which triangle won each pixel, then shades every visible pixel once after
+// all triangles of the tile are drawn, so overdraw no longer costs shading.
+// Both produce the same image.
+enum class ShadingMode { Forward, Visibility };
+
 class Renderer {
 public:
   Renderer(int width, int height, const char *title);
   ~Renderer();
 
+  // Takes effect at the next flush
+  void setShadingMode(ShadingMode mode) { shadingMode = mode; }
+  ShadingMode getShadingMode() const { return shadingMode; }
+  // Off, every draw takes the one raster/shade variant that checks the
+  // material's features per pixel instead of the one built for them. Both
+  // produce the same image, the generic path is a reference for tests.
+  // Takes effect at the next renderMesh.
+  void setSpecializedPipelines(bool on) { specialized = on; }
+
   void clear(uint32_t color = 0xFF000000);
   void present();
+  // width * height pixels, row-major, as of the last flush
+  const uint32_t *getFramebuffer() const { return framebuffer; }
+  // Triangles renderMesh skipped since the last clear() because a corner
+  // wasn't finite
+  std::size_t getDroppedTriangles() const { return droppedTriangles; }
 
   Vec3 project(const Vec4 &point, const Mat4 &globalMat,
                        const Mat4 &viewM, const Mat4 &perspM) const ;
@@ -29,15 +54,21 @@ public:
 
   float edgeFunction(const Vec3 &a, const Vec3 &b, const Vec3 &c) const;
 
-  void drawTriangle(const Mesh *mesh, const Triangle &tri,
-                    const std::vector<Vec3> &vertices,
-                    const  Mat4 & globalMat,
-                    const TransformComponent &cameraTransform,
-                    const CameraComponent &camera, const MaterialComponent& material);
+  // Camera matrices, frustum and view space light for one frame. cameraMat
+  // is the camera's GlobalTransform::worldMatrix.
+  RenderView prepareView(const Mat4 &cameraMat,
+                         const CameraComponent &camera) const;
 
-  void renderMesh(const Mesh *mesh, const Mat4 & globalMat,
-                  const TransformComponent &cameraTransform,
-                  const CameraComponent &camera, const MaterialComponent& material);
+  // Geometry phase: vertex stage, then sets up and bins every triangle
+  void renderMesh(const Mesh *mesh, const GlobalTransform &global,
+                  const RenderView &view, const MaterialComponent& material);
+
+  // Raster phase: fills the pixels of everything queued since the last
+  // flush, tile by tile, on jobs when given. Each tile belongs to one worker
+  // and takes its triangles in submission order, so no locks are needed and
+  // the output is the same for any number of threads. present() flushes
+  // what is left, clear() drops it.
+  void flush(JobSystem *jobs = nullptr);
 
   void renderWorld(Mesh *mesh, const TransformComponent &entityTransform,
                    const TransformComponent &cameraTransform,
@@ -54,7 +85,139 @@ public:
   uint32_t *framebuffer = nullptr;
   std::vector<float> zBuffer;
 
+  // Farthest zBuffer value of every HiZBlock x HiZBlock block, row-major.
+  // Triangles whose nearest corner is behind it skip the block. Blocks lie
+  // within one tile, so tile workers update them without locking.
+  static constexpr int HiZBlock = 8;
+  int hiZWidth = 0;
+  std::vector<float> hiZ;
+  void updateHiZ(int blockX, int blockY);
+
   Vec3 lightDir = Vec3(0, 0, 1);
+
+  // clip space position (x, y, z, w) to screen pixels and NDC depth
+  Vec3 toScreen(float x, float y, float z, float w) const;
+
+  // Triangle corner ready for rasterization: screen position (pixels, NDC
+  // depth), mesh space position, texture coordinates and, for smooth
+  // shading, the view space normal
+  struct RasterVertex {
+    Vec3 screen;
+    Vec3 position;
+    Vec3 uv;
+    Vec3 normal;
+  };
+  // Flat shading terms shared by every pixel of a triangle
+  struct TriangleShading {
+    float diffuse;
+    Vec3 reflectDir;
+  };
+  // Triangle queued for the raster phase. The bounding box is scissored to
+  // the screen, corners may lie outside it.
+  struct SetupTriangle {
+    RasterVertex corners[3];
+    TriangleShading shading;
+    float invArea;
+    int minX, maxX, minY, maxY;
+    uint32_t draw; // index into draws
+    uint32_t id;   // packed draw and triangle ids, see packId
+
+    // Edge function values at pixel (x, y), the floats rasterTriangle
+    // computes for it
+    void edges(int x, int y, float &w0, float &w1, float &w2) const;
+  };
+  // Raster pipeline features, fixed per draw. Each combination is a separate
+  // instantiation of rasterTriangle and shadePixel, so the pixel loops carry
+  // no checks or work for features a material doesn't use.
+  enum PipelineFeature {
+    Textured = 1,
+    Specular = 2,
+    SmoothNormals = 4,
+    DepthTested = 8,
+    Deferred = 16, // visibility mode raster pass, no shading
+    Dynamic = 32,  // reads the other bits from Draw::features per pixel
+  };
+  using RasterFn = void (Renderer::*)(const SetupTriangle &t, int x0, int y0,
+                                      int x1, int y1);
+  using ShadeFn = uint32_t (Renderer::*)(const SetupTriangle &t, float alpha,
+                                         float beta, float gamma) const;
+
+  // What the pixels of a renderMesh call need after it returns
+  struct Draw {
+    MaterialComponent material;
+    Vec3 cameraPos;
+    Vec3 toLight;           // view space, for smooth normals
+    uint32_t firstTriangle; // its first entry in triangles
+    int features;           // PipelineFeature bits
+    RasterFn raster;
+    RasterFn rasterDeferred;
+    ShadeFn shade;
+  };
+  // Whether variant Features runs with feature on for draw
+  template <int Features> static bool uses(const Draw &draw, int feature) {
+    if constexpr ((Features & Dynamic) != 0)
+      return (draw.features & feature) != 0;
+    else
+      return (Features & feature) != 0;
+  }
+  // Picks the pipeline variants for features
+  void choosePipeline(Draw &draw, int features) const;
+  bool specialized = true;
+
+  // Visibility buffer entries: the draw id in the high bits, the triangle's
+  // index among that draw's set-up triangles in the low ones
+  static constexpr int TriangleIdBits = 20;
+  static constexpr uint32_t MaxDraws = 1u << (32 - TriangleIdBits);
+  static constexpr uint32_t MaxDrawTriangles = 1u << TriangleIdBits;
+  static constexpr uint32_t NoTriangle = 0xFFFFFFFF;
+  static uint32_t packId(uint32_t draw, uint32_t triangle) {
+    return (draw << TriangleIdBits) | triangle;
+  }
+
+  ShadingMode shadingMode = ShadingMode::Forward;
+  // Visibility mode: winning triangle of every pixel, NoTriangle where none
+  // is waiting to be shaded
+  std::vector<uint32_t> visibility;
+
+  static constexpr int TileSize = 64;
+  int tilesX = 0;
+  int tilesY = 0;
+  std::vector<Draw> draws;
+  std::vector<SetupTriangle> triangles;
+  // indices into triangles per tile, row-major
+  std::vector<std::vector<uint32_t>> bins;
+  std::size_t droppedTriangles = 0;
+
+  // Step of renderMesh: sets up a triangle and bins it into the screen
+  // tiles it overlaps, its pixels are written by flush(). clip and screen
+  // hold the mesh's vertices after the vertex stage, normalMat maps its
+  // normals to world. The pixels take the Draw renderMesh pushed for
+  // material, so it only makes sense inside renderMesh.
+  void drawTriangle(const Mesh *mesh, const Triangle &tri,
+                    const math::ClipVertices &clip,
+                    const math::ScreenVertices &screen,
+                    const Mat4x3 &normalMat, const RenderView &view,
+                    const MaterialComponent& material);
+  // Queues a triangle drawTriangle has clipped as needed
+  void binTriangle(const RasterVertex &c0, const RasterVertex &c1,
+                   const RasterVertex &c2, const TriangleShading &shading);
+  void rasterTile(std::size_t tile);
+  // Fills the pixels of t inside [x0, x1] x [y0, y1], with Deferred only
+  // their depth and id
+  template <int Features>
+  void rasterTriangle(const SetupTriangle &t, int x0, int y0, int x1, int y1);
+  // Color of the pixel at barycentrics (alpha, beta, gamma) of t
+  template <int Features>
+  uint32_t shadePixel(const SetupTriangle &t, float alpha, float beta,
+                      float gamma) const;
+  // Visibility mode: shades the pixels of a tile rasterTriangle left ids in
+  void resolveTile(int x0, int y0, int x1, int y1);
+
+  // renderMesh scratch, kept across draws so it only grows: clip and screen
+  // space vertices, and positions of meshes without an SoA mirror
+  math::ClipVertices clip;
+  math::ScreenVertices screen;
+  std::vector<float> soaX, soaY, soaZ;
 };
 
 } // namespace engine
@@ -40,6 +40,11 @@ class World;
 
 class Serializer {
 public:
+  // Written as "version". Scenes without one predate version 2, where a
+  // camera's rotation.x pitched its view the opposite way; loadScene()
+  // converts them.
+  static constexpr int SceneVersion = 2;
+
   static void saveScene(World &world, const std::string &filepath);
   static void loadScene(World &world, const std::string &filepath);
 };
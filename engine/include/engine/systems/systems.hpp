@@ -3,6 +3,8 @@
 #include "engine/renderer/renderer.hpp"
 #include "engine/input/controller.hpp"
 #include <memory>
+#include <utility>
+#include <vector>
 
 namespace engine {
 class RenderSystem : public System {
@@ -13,6 +15,8 @@ public:
 
     void update(World& world, float dt) override;
 
+    void declareAccess(SystemAccess& access) override;
+
 private:
     Renderer* renderer;
 };
@@ -23,8 +27,9 @@ class ScriptSystem : public System {
 
     void update(World& world,float  dt) override;
 
-  
-
+    // Per-frame scratch. Scripts run after the view is gone, so they can
+    // add/remove components and destroy entities directly
+    std::vector<ScriptPtr> scripts;
 }; 
 
 class HierarchySystem : public System {
@@ -32,9 +37,17 @@ class HierarchySystem : public System {
     void start(World& world) override{};
 
     void update(World& world,float  dt) override;
-    
-    
 
+    void declareAccess(SystemAccess& access) override;
+
+    // Smallest batch of nodes worth a job
+    static constexpr std::size_t MinBatchNodes = 1024;
+
+    // Per-frame scratch, see update()
+    std::vector<Entity> dirty;
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    // ranges[batches[i]] to ranges[batches[i + 1]] form one job
+    std::vector<std::size_t> batches;
 };
  
 class CameraControllerSystem : public System{
@@ -45,6 +58,8 @@ class CameraControllerSystem : public System{
 
   void update(World& world, float dt) override;
 
+  void declareAccess(SystemAccess& access) override;
+
   private:
     Controller* controller;
 };
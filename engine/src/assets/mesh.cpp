@@ -1,5 +1,7 @@
 #include "engine/assets/mesh.hpp"
 #include "engine/math/vec3.hpp"
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -44,6 +46,9 @@ std::shared_ptr<Mesh> Mesh::createSphere(float radius, int latSegments,
 
   mesh->type = "Sphere";
   mesh->textureMap.resize(mesh->vertices.size(), Vec3(0)); // dummy UV
+  mesh->updateSoA();
+  mesh->updateBounds();
+  mesh->updateNormals();
 
   return mesh;
 }
@@ -88,6 +93,9 @@ std::shared_ptr<Mesh> Mesh::createBox(float width, float height, float depth) {
                      {0, 5, 4}};
 
   mesh->textureMap.resize(mesh->vertices.size(), Vec3(0.0f, 0.0f, 0.0f));
+  mesh->updateSoA();
+  mesh->updateBounds();
+  mesh->updateNormals();
 
   return mesh;
 }
@@ -147,6 +155,54 @@ std::shared_ptr<Mesh> Mesh::loadFromObj(const std::string &filename) {
     }
   }
 
+  mesh->updateSoA();
+  mesh->updateBounds();
+  mesh->updateNormals();
   return mesh;
 }
+
+void Mesh::updateSoA() {
+  xs.resize(vertices.size());
+  ys.resize(vertices.size());
+  zs.resize(vertices.size());
+  for (std::size_t i = 0; i < vertices.size(); ++i) {
+    xs[i] = vertices[i].x;
+    ys[i] = vertices[i].y;
+    zs[i] = vertices[i].z;
+  }
+}
+
+void Mesh::updateBounds() {
+  if (vertices.empty()) {
+    boundsCenter = Vec3(0);
+    boundsRadius = -1.0f;
+    return;
+  }
+
+  // center of the box around the vertices, then the farthest vertex from it
+  Vec3 lo = vertices[0], hi = vertices[0];
+  for (const Vec3 &v : vertices) {
+    lo = Vec3(std::min(lo.x, v.x), std::min(lo.y, v.y), std::min(lo.z, v.z));
+    hi = Vec3(std::max(hi.x, v.x), std::max(hi.y, v.y), std::max(hi.z, v.z));
+  }
+  boundsCenter = (lo + hi) * 0.5f;
+  float radiusSq = 0;
+  for (const Vec3 &v : vertices)
+    radiusSq = std::max(radiusSq, (v - boundsCenter).dot(v - boundsCenter));
+  boundsRadius = std::sqrt(radiusSq);
+}
+
+void Mesh::updateNormals() {
+  normals.assign(vertices.size(), Vec3(0));
+  for (const Triangle &tri : triangles) {
+    // the cross product's length is twice the face's area
+    const Vec3 &v0 = vertices[tri.i0];
+    Vec3 n = (vertices[tri.i1] - v0).cross(vertices[tri.i2] - v0);
+    normals[tri.i0] = normals[tri.i0] + n;
+    normals[tri.i1] = normals[tri.i1] + n;
+    normals[tri.i2] = normals[tri.i2] + n;
+  }
+  for (Vec3 &n : normals)
+    n = n.normalized();
+}
 } // namespace engine
@@ -0,0 +1,83 @@
+#include "engine/components/components.hpp"
+#include <thread>
+
+namespace engine {
+
+struct GlobalTransform::Cache {
+  enum State : uint8_t { Stale, Computing, Ready };
+
+  Mat4x3 inverse;
+  Mat4x3 normal;
+  std::atomic<uint8_t> state{Stale};
+};
+
+GlobalTransform::GlobalTransform(GlobalTransform &&other) noexcept
+    : worldMatrix(other.worldMatrix),
+      cache(other.cache.exchange(nullptr, std::memory_order_relaxed)) {}
+
+GlobalTransform &GlobalTransform::operator=(const GlobalTransform &other) {
+  set(other.worldMatrix);
+  return *this;
+}
+
+GlobalTransform &
+GlobalTransform::operator=(GlobalTransform &&other) noexcept {
+  if (this != &other) {
+    worldMatrix = other.worldMatrix;
+    delete cache.exchange(
+        other.cache.exchange(nullptr, std::memory_order_relaxed),
+        std::memory_order_relaxed);
+  }
+  return *this;
+}
+
+GlobalTransform::~GlobalTransform() {
+  delete cache.load(std::memory_order_relaxed);
+}
+
+void GlobalTransform::set(const Mat4 &world) {
+  worldMatrix = world;
+  invalidate();
+}
+
+// Writers have the component to themselves, so no readers are in cached()
+void GlobalTransform::invalidate() {
+  if (Cache *c = cache.load(std::memory_order_relaxed))
+    c->state.store(Cache::Stale, std::memory_order_relaxed);
+}
+
+const GlobalTransform::Cache &GlobalTransform::cached() const {
+  Cache *c = cache.load(std::memory_order_acquire);
+  if (!c) {
+    Cache *fresh = new Cache;
+    if (cache.compare_exchange_strong(c, fresh, std::memory_order_acq_rel))
+      c = fresh;
+    else
+      delete fresh;
+  }
+
+  if (c->state.load(std::memory_order_acquire) == Cache::Ready)
+    return *c;
+
+  // one reader computes, the others wait for it
+  uint8_t expected = Cache::Stale;
+  if (c->state.compare_exchange_strong(expected, Cache::Computing,
+                                       std::memory_order_acquire)) {
+    Mat4x3 affine(worldMatrix);
+    c->normal = affine.normalMatrix();
+    c->inverse = affine.inverse();
+    c->state.store(Cache::Ready, std::memory_order_release);
+  } else {
+    while (c->state.load(std::memory_order_acquire) != Cache::Ready)
+      std::this_thread::yield();
+  }
+  return *c;
+}
+
+const Mat4x3 &GlobalTransform::inverse() const { return cached().inverse; }
+
+const Mat4x3 &GlobalTransform::normalMatrix() const {
+  return cached().normal;
+}
+
+} // namespace engine
@@ -0,0 +1,165 @@
+#include "engine/core/jobSystem.hpp"
+
+namespace engine {
+
+// The pool the current thread works for, if any
+static thread_local const JobSystem *currentOwner = nullptr;
+static thread_local unsigned currentIndex = 0;
+
+unsigned JobSystem::threadIndex() { return currentIndex; }
+
+std::size_t JobSystem::self() const {
+  return currentOwner == this ? currentIndex : 0;
+}
+
+JobSystem::JobSystem(unsigned workerCount) {
+  if (workerCount == 0)
+    workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+  for (unsigned i = 0; i <= workerCount; ++i)
+    queues.push_back(std::make_unique<Queue>());
+  for (unsigned i = 1; i <= workerCount; ++i)
+    workers.emplace_back([this, i] { loop(i); });
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &worker : workers)
+    worker.join();
+}
+
+void JobSystem::run(std::function<void()> job, Counter *counter) {
+  submit({[](void *data, std::size_t, std::size_t) {
+            std::unique_ptr<std::function<void()>> fn(
+                static_cast<std::function<void()> *>(data));
+            (*fn)();
+          },
+          new std::function<void()>(std::move(job)), 0, 0, counter});
+}
+
+void JobSystem::runAfter(Counter &dependency, std::function<void()> job,
+                         Counter *counter) {
+  Job continuation{[](void *data, std::size_t, std::size_t) {
+                     std::unique_ptr<std::function<void()>> fn(
+                         static_cast<std::function<void()> *>(data));
+                     (*fn)();
+                   },
+                   new std::function<void()>(std::move(job)), 0, 0, counter};
+  // counted now, so waiting on counter also waits for the dependency
+  if (counter)
+    ++counter->pending;
+
+  {
+    std::lock_guard<std::mutex> lock(dependency.mutex);
+    if (dependency.pending.load() != 0) {
+      dependency.continuations.push_back(continuation);
+      return;
+    }
+  }
+  push(continuation);
+}
+
+void JobSystem::wait(Counter &counter) {
+  Job job;
+  while (!counter.done()) {
+    if (next(job))
+      execute(job);
+    else
+      std::this_thread::yield();
+  }
+}
+
+void JobSystem::submit(const Job &job) {
+  if (job.counter)
+    ++job.counter->pending;
+  push(job);
+}
+
+void JobSystem::push(const Job &job) {
+  Queue &queue = *queues[self()];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.jobs.push_back(job);
+  }
+  ++queued;
+  if (sleepers.load() > 0) {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    wake.notify_one();
+  }
+}
+
+bool JobSystem::next(Job &job) {
+  if (queued.load() == 0)
+    return false;
+
+  std::size_t own = self();
+  {
+    // own jobs newest first, they are the most likely to be in cache
+    Queue &queue = *queues[own];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.jobs.empty()) {
+      job = queue.jobs.back();
+      queue.jobs.pop_back();
+      --queued;
+      return true;
+    }
+  }
+  for (std::size_t i = 1; i < queues.size(); ++i) {
+    Queue &victim = *queues[(own + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.jobs.empty()) {
+      job = victim.jobs.front();
+      victim.jobs.pop_front();
+      --queued;
+      return true;
+    }
+  }
+  return false;
+}
+
+void JobSystem::execute(const Job &job) {
+  job.fn(job.data, job.begin, job.end);
+  if (job.counter)
+    finish(*job.counter);
+}
+
+void JobSystem::finish(Counter &counter) {
+  ++counter.finishing;
+  if (--counter.pending == 0) {
+    std::vector<Job> ready;
+    {
+      std::lock_guard<std::mutex> lock(counter.mutex);
+      ready.swap(counter.continuations);
+    }
+    // already counted by runAfter
+    for (const Job &job : ready)
+      push(job);
+  }
+  // last access, the counter may be destroyed from here on
+  --counter.finishing;
+}
+
+void JobSystem::loop(unsigned index) {
+  currentOwner = this;
+  currentIndex = index;
+  Job job;
+  for (;;) {
+    if (next(job)) {
+      execute(job);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    ++sleepers;
+    wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+    --sleepers;
+    if (stopping)
+      return;
+  }
+}
+
+} // namespace engine
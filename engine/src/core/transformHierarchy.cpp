@@ -0,0 +1,207 @@
+#include "engine/core/transformHierarchy.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace engine {
+
+uint32_t TransformHierarchy::indexOf(Entity entity) const {
+  uint32_t slot = entityIndex(entity);
+  if (slot >= slots.size() || slots[slot] == None ||
+      entities[slots[slot]] != entity)
+    return None;
+  return slots[slot];
+}
+
+bool TransformHierarchy::inSubtree(Entity entity, Entity ancestor) const {
+  uint32_t index = indexOf(entity);
+  uint32_t root = indexOf(ancestor);
+  if (index == None || root == None)
+    return entity == ancestor;
+  if (!unordered)
+    return index >= root && index < root + sizes[root];
+  // children of an erased node are roots already
+  for (uint32_t a = index; a != None && entities[a] != NullEntity;
+       a = parents[a]) {
+    if (a == root)
+      return true;
+  }
+  return false;
+}
+
+void TransformHierarchy::insert(Entity entity) {
+  uint32_t slot = entityIndex(entity);
+  if (slot >= slots.size())
+    slots.resize(slot + 1, None);
+  if (slots[slot] != None) {
+    if (entities[slots[slot]] == entity)
+      return;
+    erase(entities[slots[slot]]); // a destroyed entity's stale node
+  }
+
+  slots[slot] = static_cast<uint32_t>(entities.size());
+  entities.push_back(entity);
+  parents.push_back(None);
+  sizes.push_back(1);
+  local.push_back(Mat4::identity());
+  world.push_back(Mat4::identity());
+}
+
+void TransformHierarchy::erase(Entity entity) {
+  uint32_t index = indexOf(entity);
+  if (index == None)
+    return;
+
+  // Left in place so nothing shifts. Its children still point at it and
+  // become roots in compact().
+  if (sizes[index] > 1)
+    unordered = true;
+  entities[index] = NullEntity;
+  slots[entityIndex(entity)] = None;
+  // amortized, for worlds whose HierarchySystem doesn't compact every frame
+  if (++erased > entities.size() / 2)
+    compact();
+}
+
+void TransformHierarchy::compact() {
+  if (unordered) {
+    reorder();
+    return;
+  }
+  if (erased == 0)
+    return;
+
+  // erased nodes have no children, so the kept ones keep their order and
+  // parents
+  remap.assign(entities.size(), None);
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < entities.size(); ++i) {
+    if (entities[i] == NullEntity)
+      continue;
+    remap[i] = kept;
+    entities[kept] = entities[i];
+    parents[kept] = parents[i] == None ? None : remap[parents[i]];
+    local[kept] = local[i];
+    world[kept] = world[i];
+    slots[entityIndex(entities[kept])] = kept;
+    ++kept;
+  }
+  entities.resize(kept);
+  parents.resize(kept);
+  local.resize(kept);
+  world.resize(kept);
+  computeSizes();
+  erased = 0;
+}
+
+void TransformHierarchy::reorder() {
+  const uint32_t count = static_cast<uint32_t>(entities.size());
+  // Parent of every kept node, count for roots and children of erased
+  // nodes. Counting sort by it lists the children of each node, in index
+  // order, in children[childStart[p], childStart[p + 1]).
+  auto key = [&](uint32_t i) {
+    uint32_t p = parents[i];
+    return p == None || entities[p] == NullEntity ? count : p;
+  };
+  childStart.assign(count + 2, 0);
+  for (uint32_t i = 0; i < count; ++i) {
+    if (entities[i] != NullEntity)
+      ++childStart[key(i) + 1];
+  }
+  for (uint32_t i = 0; i <= count; ++i)
+    childStart[i + 1] += childStart[i];
+  children.resize(childStart[count + 1]);
+  fill.assign(childStart.begin(), childStart.end() - 1);
+  for (uint32_t i = 0; i < count; ++i) {
+    if (entities[i] != NullEntity)
+      children[fill[key(i)]++] = i;
+  }
+
+  // depth first from the roots, each node lands before its subtree
+  order.clear();
+  remap.assign(count, None);
+  stack.clear();
+  for (uint32_t c = childStart[count + 1]; c-- > childStart[count];)
+    stack.push_back(children[c]);
+  while (!stack.empty()) {
+    uint32_t node = stack.back();
+    stack.pop_back();
+    remap[node] = static_cast<uint32_t>(order.size());
+    order.push_back(node);
+    for (uint32_t c = childStart[node + 1]; c-- > childStart[node];)
+      stack.push_back(children[c]);
+  }
+
+  const uint32_t kept = static_cast<uint32_t>(order.size());
+  std::vector<Entity> newEntities(kept);
+  std::vector<uint32_t> newParents(kept);
+  std::vector<Mat4> newLocal(kept), newWorld(kept);
+  for (uint32_t k = 0; k < kept; ++k) {
+    uint32_t old = order[k];
+    uint32_t p = key(old);
+    newEntities[k] = entities[old];
+    newParents[k] = p == count ? None : remap[p];
+    newLocal[k] = local[old];
+    newWorld[k] = world[old];
+    slots[entityIndex(newEntities[k])] = k;
+  }
+  entities.swap(newEntities);
+  parents.swap(newParents);
+  local.swap(newLocal);
+  world.swap(newWorld);
+  computeSizes();
+  erased = 0;
+  unordered = false;
+}
+
+void TransformHierarchy::computeSizes() {
+  uint32_t count = static_cast<uint32_t>(entities.size());
+  sizes.assign(count, 1);
+  for (uint32_t i = count; i-- > 0;) {
+    if (parents[i] != None)
+      sizes[parents[i]] += sizes[i];
+  }
+}
+
+void TransformHierarchy::attach(Entity child, Entity parent) {
+  if (inSubtree(parent, child))
+    throw std::invalid_argument("Entity cannot be parented to itself or to "
+                                "one of its descendants");
+  insert(child);
+  insert(parent);
+
+  uint32_t c = indexOf(child);
+  uint32_t p = indexOf(parent);
+  if (parents[c] == p)
+    return;
+  parents[c] = p;
+  unordered = true;
+}
+
+void TransformHierarchy::detach(Entity child) {
+  uint32_t c = indexOf(child);
+  if (c == None || parents[c] == None)
+    return;
+  parents[c] = None;
+  unordered = true;
+}
+
+void TransformHierarchy::clear() {
+  entities.clear();
+  parents.clear();
+  sizes.clear();
+  local.clear();
+  world.clear();
+  slots.clear();
+  erased = 0;
+  unordered = false;
+}
+
+void TransformHierarchy::update(uint32_t begin, uint32_t end) {
+  for (uint32_t i = begin; i < end; ++i) {
+    uint32_t parent = parents[i];
+    world[i] = parent == None ? local[i] : world[parent] * local[i];
+  }
+}
+
+} // namespace engine
@@ -1,31 +1,172 @@
 #include "engine/core/world.hpp"
 #include "engine/components/components.hpp"
+#include "engine/ecs/commandBuffer.hpp"
 #include "engine/ecs/system.hpp"
 #include "engine/script/script.hpp"
 #include "engine/serialization/serializer.hpp"
 #include "engine/thirdparty/nlohmann/json.hpp"
 #include <algorithm>
+#include <atomic>
+#include <stdexcept>
 #include <vector>
 
 namespace engine {
-Entity World::createEntity() {
+static std::atomic<uint64_t> nextWorldId{1};
 
-  Entity id = _nextEntity++;
-  entities.push_back(id);
-  return id;
+World::World(StorageMode storageMode)
+    : componentManager(storageMode), _worldId(nextWorldId++) {}
+
+World::~World() = default;
+
+Entity World::createEntity() { return entityRegistry.create(); }
+
+Entity World::createEntityWithId(Entity id) {
+  Entity entity = entityRegistry.create(id);
+  return entity != NullEntity ? entity : entityRegistry.create();
+}
+
+void World::destroyEntity(Entity entity) {
+  if (!entityRegistry.alive(entity))
+    return;
+  // throws before the hierarchy below is touched
+  componentManager.assertUnlocked();
+
+  // erased first, it turns the children into roots without moving them
+  hierarchy.erase(entity);
+  removeParent(entity);
+  removeAllChildren(entity);
+  componentManager.destroy(entity);
+  entityRegistry.destroy(entity);
+
+  if (_cameraE == entity)
+    _cameraE = NullEntity;
+}
+
+bool World::isAlive(Entity entity) const {
+  return entityRegistry.alive(entity);
+}
+
+Entity World::reserveEntity() { return entityRegistry.reserve(); }
+
+CommandBuffer &World::commands() {
+  struct Cached {
+    uint64_t world;
+    CommandBuffer *buffer;
+  };
+  // In front of the lookup below. Bounded, so a thread that outlives many
+  // worlds doesn't keep an entry for each of them.
+  constexpr std::size_t CacheSize = 8;
+  thread_local std::vector<Cached> cache;
+  for (const Cached &cached : cache) {
+    if (cached.world == _worldId)
+      return *cached.buffer;
+  }
+
+  CommandBuffer *buffer = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(commandMutex);
+    std::thread::id self = std::this_thread::get_id();
+    for (std::size_t i = 0; i < commandThreads.size(); ++i) {
+      if (commandThreads[i] == self)
+        buffer = commandBuffers[i].get();
+    }
+    if (!buffer) {
+      commandBuffers.push_back(std::make_unique<CommandBuffer>(*this));
+      commandThreads.push_back(self);
+      buffer = commandBuffers.back().get();
+    }
+  }
+  if (cache.size() == CacheSize)
+    cache.erase(cache.begin());
+  cache.push_back({_worldId, buffer});
+  return *buffer;
+}
+
+void World::flushCommands() {
+  std::lock_guard<std::mutex> lock(commandMutex);
+
+  std::size_t types = 0;
+  bool pending = false;
+  for (auto &buffer : commandBuffers) {
+    pending |= !buffer->empty();
+    types = std::max(types, buffer->queues.size());
+  }
+  if (!pending)
+    return;
+
+  for (auto &buffer : commandBuffers) {
+    for (Entity entity : buffer->created)
+      entityRegistry.materialize(entity);
+  }
+
+  // One component type at a time, so each storage is touched in one batch
+  for (std::size_t type = 0; type < types; ++type) {
+    for (auto &buffer : commandBuffers) {
+      if (type < buffer->queues.size() && buffer->queues[type])
+        buffer->queues[type]->apply(*this);
+    }
+  }
+
+  for (auto &buffer : commandBuffers) {
+    for (const auto &op : buffer->parentOps) {
+      if (!isAlive(op.child))
+        continue;
+      if (op.parent == NullEntity)
+        removeParent(op.child);
+      else if (isAlive(op.parent))
+        setParent(op.child, op.parent);
+    }
+  }
+
+  for (auto &buffer : commandBuffers) {
+    for (Entity entity : buffer->destroyed)
+      destroyEntity(entity);
+    buffer->clear();
+  }
+}
+
+void World::assertAlive(Entity entity) const {
+  if (!entityRegistry.alive(entity))
+    throw std::invalid_argument("Entity is not alive");
 }
+
 void World::clearStorages() {
+  {
+    std::lock_guard<std::mutex> lock(commandMutex);
+    for (auto &buffer : commandBuffers)
+      buffer->clear();
+  }
   componentManager.clearStorages();
-  entities.clear();
-  _nextEntity = 1;
+  hierarchy.clear();
+  entityRegistry.clear();
 }
 void World::setCameraEntity(Entity c) { _cameraE = c; }
 
 Entity World::getCamera() { return _cameraE; }
 
-const std::vector<Entity> &World::getEntities() { return entities; }
+const std::vector<Entity> &World::getEntities() {
+  return entityRegistry.getEntities();
+}
 
-void World::updateSystems(float dt) { systemManager.updateAll(*this, dt); }
+StorageMode World::getStorageMode() const {
+  return componentManager.getStorageMode();
+}
+
+void World::updateSystems(float dt) {
+  // Everything removed before the previous frame started has been seen by
+  // every system by now
+  componentManager.trimRemoved(_frameTick);
+  _frameTick = componentManager.getTicks().current;
+  systemManager.updateAll(*this, dt);
+}
+
+uint32_t World::getChangeTick() const {
+  return componentManager.getTicks().current;
+}
+
+uint32_t World::advanceChangeTick() {
+  return ++componentManager.getTicks().current;
+}
 
 void World::startSystems() { systemManager.startAll(*this); }
 
@@ -41,6 +182,19 @@ void World::addScript(uint32_t entity, ScriptPtr script) {
 }
 
 void World::setParent(Entity child, Entity parent) {
+  // both throw before anything changed
+  componentManager.assertUnlocked();
+  hierarchy.attach(child, parent);
+
+  if (hasComponent<ParentComponent>(child)) {
+    Entity previous = getComponent<const ParentComponent>(child).parent;
+    if (previous != parent && hasComponent<ChildrenComponent>(previous)) {
+      auto &siblings = getComponent<ChildrenComponent>(previous).children;
+      siblings.erase(std::remove(siblings.begin(), siblings.end(), child),
+                     siblings.end());
+    }
+  }
+
   if (!hasComponent<ChildrenComponent>(parent)) {
     addComponent(parent, ChildrenComponent{});
   }
@@ -59,6 +213,7 @@ void World::setParent(Entity child, Entity parent) {
 void World::removeParent(Entity child) {
   if (!hasComponent<ParentComponent>(child))
     return;
+  componentManager.assertUnlocked();
 
   Entity parent = getComponent<ParentComponent>(child).parent;
 
@@ -69,11 +224,13 @@ void World::removeParent(Entity child) {
   }
 
   removeComponent<ParentComponent>(child);
+  hierarchy.detach(child);
 }
 void World::removeChild(Entity parent, Entity child) {
 
   if (!hasComponent<ChildrenComponent>(parent))
     return;
+  componentManager.assertUnlocked();
 
   auto &children = getComponent<ChildrenComponent>(parent).children;
   children.erase(std::remove(children.begin(), children.end(), child),
@@ -82,6 +239,7 @@ void World::removeChild(Entity parent, Entity child) {
   if (hasComponent<ParentComponent>(child) &&
       getComponent<ParentComponent>(child).parent == parent) {
     removeComponent<ParentComponent>(child);
+    hierarchy.detach(child);
   }
 }
 
@@ -93,6 +251,7 @@ void World::removeAllChildren(Entity parent) {
   for (Entity child : children) {
     if (hasComponent<ParentComponent>(child)) {
       removeComponent<ParentComponent>(child);
+      hierarchy.detach(child);
     }
   }
   children.clear();
@@ -100,10 +259,12 @@ void World::removeAllChildren(Entity parent) {
 
 std::vector<Entity> World::getChildren(Entity parent) {
   if (hasComponent<ChildrenComponent>(parent)) {
-    return getComponent<ChildrenComponent>(parent).children;
+    return getComponent<const ChildrenComponent>(parent).children;
   }
   return std::vector<Entity>();
 }
+TransformHierarchy &World::getHierarchy() { return hierarchy; }
+
 const std::unordered_map<std::string, ComponentSerializer> &
 World::getSerializers() {
   return componentManager.getSerializerRegistry().getAll();
@@ -125,15 +286,15 @@ void World::registerDefaults() {
   registerComponent<TransformComponent>(
       "TransformComponent",
       [](World &world, Entity e) -> json {
-        const auto &comp = world.getComponent<TransformComponent>(e);
+        const auto &comp = world.getComponent<const TransformComponent>(e);
         return {{"position", comp.position},
-                {"rotation", comp.rotation},
+                {"rotation", comp.getEuler()},
                 {"scale", comp.scale}};
       },
       [](World &world, Entity e, const json &j) {
         TransformComponent comp;
         comp.position = j.at("position").get<Vec3>();
-        comp.rotation = j.at("rotation").get<Vec3>();
+        comp.setEuler(j.at("rotation").get<Vec3>());
         comp.scale = j.at("scale").get<Vec3>();
         world.addComponent<TransformComponent>(e, comp);
       });
@@ -141,7 +302,7 @@ void World::registerDefaults() {
   registerComponent<GlobalTransform>(
       "GlobalTransform",
       [](World &world, Entity e) -> json {
-        const auto &comp = world.getComponent<GlobalTransform>(e);
+        const auto &comp = world.getComponent<const GlobalTransform>(e);
         return {{"worldMatrix", comp.worldMatrix}};
       },
       [](World &world, Entity e, const json &j) {
@@ -153,7 +314,7 @@ void World::registerDefaults() {
   registerComponent<CameraComponent>(
       "CameraComponent",
       [](World &world, Entity e) -> json {
-        const auto &comp = world.getComponent<CameraComponent>(e);
+        const auto &comp = world.getComponent<const CameraComponent>(e);
         return {{"fov", comp.fov},
                 {"aspectRatio", comp.aspectRatio},
                 {"nearPlane", comp.nearPlane},
@@ -171,7 +332,7 @@ void World::registerDefaults() {
   registerComponent<CameraControllerComponent>(
       "CameraControllerComponent",
       [](World &world, Entity e) -> json {
-        const auto &comp = world.getComponent<CameraControllerComponent>(e);
+        const auto &comp = world.getComponent<const CameraControllerComponent>(e);
         return {{"sens", comp.sens},
                 {"speed", comp.speed},
                 {"active", comp.active}};
@@ -187,7 +348,7 @@ void World::registerDefaults() {
   registerComponent<MeshComponent>(
       "MeshComponent",
       [](World &world, Entity e) -> json {
-        const auto &comp = world.getComponent<MeshComponent>(e);
+        const auto &comp = world.getComponent<const MeshComponent>(e);
         return {{"mesh", comp.mesh ? comp.mesh->path : ""},
                 {"type", comp.mesh ? comp.mesh->type : "None"},
                 {"size", comp.mesh ? comp.mesh->size : Vec3(1)},
@@ -213,12 +374,14 @@ void World::registerDefaults() {
   registerComponent<MaterialComponent>(
       "MaterialComponent",
       [](World &world, Entity e) -> json {
-        const auto &comp = world.getComponent<MaterialComponent>(e);
+        const auto &comp = world.getComponent<const MaterialComponent>(e);
         return {{"baseColor", comp.baseColor},
                 {"ambient", comp.ambient},
                 {"specular", comp.specular},
                 {"shininess", comp.shininess},
                 {"useTexture", comp.useTexture},
+                {"smoothShading", comp.smoothShading},
+                {"depthTest", comp.depthTest},
                 {"texture", comp.texture ? comp.texture->path : ""}};
       },
       [](World &world, Entity e, const json &j) {
@@ -228,6 +391,8 @@ void World::registerDefaults() {
         comp.specular = j.at("specular").get<float>();
         comp.shininess = j.at("shininess").get<float>();
         comp.useTexture = j.at("useTexture").get<bool>();
+        comp.smoothShading = j.value("smoothShading", false);
+        comp.depthTest = j.value("depthTest", true);
         std::string path = j.at("texture").get<std::string>();
         if (!path.empty()) {
           comp.texture = Texture::loadFromBmp(path);
@@ -239,7 +404,7 @@ void World::registerDefaults() {
       "ScriptComponent",
 
       [](World &world, Entity e) -> json {
-        const auto &comp = world.getComponent<ScriptComponent>(e);
+        const auto &comp = world.getComponent<const ScriptComponent>(e);
         return {{"script", comp.script ? comp.script->name : ""}};
       },
 
@@ -259,7 +424,7 @@ void World::registerDefaults() {
   registerComponent<ParentComponent>(
       "ParentComponent",
       [](World &world, Entity e) -> json {
-        const auto &comp = world.getComponent<ParentComponent>(e);
+        const auto &comp = world.getComponent<const ParentComponent>(e);
         return {{"parent", comp.parent}};
       },
       [](World &world, Entity e, const json &j) {
@@ -271,7 +436,7 @@ void World::registerDefaults() {
   registerComponent<ChildrenComponent>(
       "ChildrenComponent",
       [](World &world, Entity e) -> json {
-        const auto &comp = world.getComponent<ChildrenComponent>(e);
+        const auto &comp = world.getComponent<const ChildrenComponent>(e);
         return {{"children", comp.children}};
       },
       [](World &world, Entity e, const json &j) {
@@ -0,0 +1,260 @@
+#include "engine/ecs/archetype.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace engine {
+
+void ComponentInfo::relocate(void *dst, void *src) const {
+  if (trivial) {
+    std::memcpy(dst, src, size);
+    return;
+  }
+  moveConstruct(dst, src);
+  destroy(src);
+}
+
+static std::size_t alignUp(std::size_t value, std::size_t align) {
+  return (value + align - 1) / align * align;
+}
+
+// A row as chunk and slot, so moving all of its columns divides only once
+struct RowAt {
+  std::size_t chunk, slot;
+};
+
+static RowAt rowAt(const Archetype &archetype, uint32_t row) {
+  return {row / archetype.capacity(), row % archetype.capacity()};
+}
+
+static void *componentAt(Archetype &archetype, RowAt at, int column) {
+  return static_cast<unsigned char *>(archetype.columnData(at.chunk, column)) +
+         at.slot * archetype.signature()[column]->size;
+}
+
+// Copies the added/changed ticks of a column between rows
+static void copyTicks(Archetype &to, RowAt dst, int toColumn, Archetype &from,
+                      RowAt src, int fromColumn) {
+  to.addedTicks(dst.chunk, toColumn)[dst.slot] =
+      from.addedTicks(src.chunk, fromColumn)[src.slot];
+  to.changedTicks(dst.chunk, toColumn)[dst.slot] =
+      from.changedTicks(src.chunk, fromColumn)[src.slot];
+}
+
+Archetype::Archetype(std::vector<const ComponentInfo *> signature)
+    : _signature(std::move(signature)) {
+  std::size_t rowBytes = sizeof(Entity);
+  for (std::size_t i = 0; i < _signature.size(); ++i) {
+    rowBytes += _signature[i]->size + 2 * sizeof(uint32_t);
+    if (_signature[i]->typeId >= columnByType.size())
+      columnByType.resize(_signature[i]->typeId + 1, -1);
+    columnByType[_signature[i]->typeId] = static_cast<int>(i);
+  }
+
+  // Start from the ideal row count and shrink until the aligned columns fit
+  offsets.resize(_signature.size());
+  tickOffsets.resize(_signature.size());
+  for (_capacity = std::max<std::size_t>(1, ChunkSize / rowBytes);;
+       --_capacity) {
+    std::size_t end = sizeof(Entity) * _capacity;
+    for (std::size_t i = 0; i < _signature.size(); ++i) {
+      offsets[i] = alignUp(end, _signature[i]->align);
+      end = offsets[i] + _signature[i]->size * _capacity;
+    }
+    for (std::size_t i = 0; i < _signature.size(); ++i) {
+      tickOffsets[i] = alignUp(end, alignof(uint32_t));
+      end = tickOffsets[i] + 2 * sizeof(uint32_t) * _capacity;
+    }
+    if (end <= ChunkSize)
+      break;
+    if (_capacity == 1)
+      throw std::length_error("Archetype row does not fit in a chunk");
+  }
+}
+
+Archetype::~Archetype() { clear(); }
+
+std::size_t Archetype::chunkSize(std::size_t chunk) const {
+  return std::min(_capacity, _size - chunk * _capacity);
+}
+
+Entity Archetype::entityAt(uint32_t row) {
+  return entities(row / _capacity)[row % _capacity];
+}
+
+void *Archetype::component(uint32_t row, int column) {
+  return static_cast<unsigned char *>(columnData(row / _capacity, column)) +
+         (row % _capacity) * _signature[column]->size;
+}
+
+uint32_t Archetype::allocate(Entity entity) {
+  if (_size == chunks.size() * _capacity) {
+    // not value-initialized, rows are written before they are read
+    chunks.push_back(spare ? std::move(spare)
+                           : std::unique_ptr<Chunk>(new Chunk));
+  }
+
+  uint32_t row = static_cast<uint32_t>(_size++);
+  entities(row / _capacity)[row % _capacity] = entity;
+  return row;
+}
+
+bool Archetype::removeRow(uint32_t row, Entity &moved) {
+  uint32_t last = static_cast<uint32_t>(_size - 1);
+  bool relocated = row != last;
+  if (relocated) {
+    RowAt dst = rowAt(*this, row), src = rowAt(*this, last);
+    for (std::size_t c = 0; c < _signature.size(); ++c) {
+      int column = static_cast<int>(c);
+      _signature[c]->relocate(componentAt(*this, dst, column),
+                              componentAt(*this, src, column));
+      copyTicks(*this, dst, column, *this, src, column);
+    }
+    moved = entities(src.chunk)[src.slot];
+    entities(dst.chunk)[dst.slot] = moved;
+  }
+
+  --_size;
+  if (!chunks.empty() && _size <= (chunks.size() - 1) * _capacity) {
+    spare = std::move(chunks.back());
+    chunks.pop_back();
+  }
+  return relocated;
+}
+
+void Archetype::clear() {
+  for (uint32_t row = 0; row < _size; ++row) {
+    for (std::size_t c = 0; c < _signature.size(); ++c)
+      _signature[c]->destroy(component(row, static_cast<int>(c)));
+  }
+  _size = 0;
+  chunks.clear();
+  spare.reset();
+}
+
+void ArchetypeStorage::clear() {
+  records.clear();
+  archetypes.clear();
+  ordered.clear();
+}
+
+void ArchetypeStorage::destroy(Entity entity) {
+  Record *record = find(entity);
+  if (record && record->archetype)
+    move(entity, *record, nullptr);
+}
+
+ArchetypeStorage::Record *ArchetypeStorage::find(Entity entity) {
+  uint32_t index = entityIndex(entity);
+  if (index >= records.size())
+    return nullptr;
+  Record &record = records[index];
+  // a stale handle shares the slot index but not the generation
+  if (record.archetype && record.archetype->entityAt(record.row) != entity)
+    return nullptr;
+  return &record;
+}
+
+Archetype *ArchetypeStorage::archetypeOf(Entity entity) {
+  Record *record = find(entity);
+  return record ? record->archetype : nullptr;
+}
+
+ArchetypeStorage::Record &ArchetypeStorage::assure(Entity entity) {
+  uint32_t index = entityIndex(entity);
+  if (index >= records.size())
+    records.resize(index + 1);
+  return records[index];
+}
+
+Archetype *
+ArchetypeStorage::archetypeFor(std::vector<const ComponentInfo *> signature) {
+  if (signature.empty())
+    return nullptr;
+
+  auto it = archetypes.find(signature);
+  if (it != archetypes.end())
+    return it->second.get();
+
+  auto archetype = std::make_unique<Archetype>(signature);
+  Archetype *ptr = archetype.get();
+  archetypes.emplace(std::move(signature), std::move(archetype));
+  ordered.push_back(ptr);
+  return ptr;
+}
+
+Archetype *ArchetypeStorage::archetypeWith(Archetype *from,
+                                           const ComponentInfo *info) {
+  if (from && info->typeId < from->addEdges.size() &&
+      from->addEdges[info->typeId])
+    return from->addEdges[info->typeId];
+
+  std::vector<const ComponentInfo *> signature;
+  if (from)
+    signature = from->signature();
+  // by type id, so column order and chunk layout don't depend on where
+  // the ComponentInfos ended up in memory
+  signature.insert(std::upper_bound(signature.begin(), signature.end(), info,
+                                    [](const ComponentInfo *a,
+                                       const ComponentInfo *b) {
+                                      return a->typeId < b->typeId;
+                                    }),
+                   info);
+
+  Archetype *to = archetypeFor(std::move(signature));
+  if (from) {
+    if (info->typeId >= from->addEdges.size())
+      from->addEdges.resize(info->typeId + 1, nullptr);
+    from->addEdges[info->typeId] = to;
+  }
+  return to;
+}
+
+Archetype *ArchetypeStorage::archetypeWithout(Archetype *from,
+                                              const ComponentInfo *info) {
+  // the empty signature has no archetype, that edge is never cached
+  if (info->typeId < from->removeEdges.size() &&
+      from->removeEdges[info->typeId])
+    return from->removeEdges[info->typeId];
+
+  std::vector<const ComponentInfo *> signature = from->signature();
+  signature.erase(std::find(signature.begin(), signature.end(), info));
+
+  Archetype *to = archetypeFor(std::move(signature));
+  if (info->typeId >= from->removeEdges.size())
+    from->removeEdges.resize(info->typeId + 1, nullptr);
+  from->removeEdges[info->typeId] = to;
+  return to;
+}
+
+void ArchetypeStorage::move(Entity entity, Record &record, Archetype *to) {
+  Archetype *from = record.archetype;
+  uint32_t row = to ? to->allocate(entity) : 0;
+
+  if (from) {
+    // components the target lacks are destroyed, the rest relocated, so
+    // removeRow only has to fill the hole
+    const auto &signature = from->signature();
+    RowAt src = rowAt(*from, record.row);
+    RowAt dst = to ? rowAt(*to, row) : RowAt{};
+    for (std::size_t c = 0; c < signature.size(); ++c) {
+      int fromColumn = static_cast<int>(c);
+      int toColumn = to ? to->columnOf(signature[c]) : -1;
+      void *component = componentAt(*from, src, fromColumn);
+      if (toColumn < 0) {
+        signature[c]->destroy(component);
+        continue;
+      }
+      signature[c]->relocate(componentAt(*to, dst, toColumn), component);
+      copyTicks(*to, dst, toColumn, *from, src, fromColumn);
+    }
+
+    Entity moved;
+    if (from->removeRow(record.row, moved))
+      records[entityIndex(moved)].row = record.row;
+  }
+
+  record.archetype = to;
+  record.row = row;
+}
+
+} // namespace engine
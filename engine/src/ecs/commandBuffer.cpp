@@ -0,0 +1,40 @@
+#include "engine/ecs/commandBuffer.hpp"
+
+namespace engine {
+
+Entity CommandBuffer::createEntity() {
+  Entity entity = world.reserveEntity();
+  created.push_back(entity);
+  ++pending;
+  return entity;
+}
+
+void CommandBuffer::destroyEntity(Entity entity) {
+  destroyed.push_back(entity);
+  ++pending;
+}
+
+void CommandBuffer::setParent(Entity child, Entity parent) {
+  parentOps.push_back({child, parent});
+  ++pending;
+}
+
+void CommandBuffer::removeParent(Entity child) {
+  parentOps.push_back({child, NullEntity});
+  ++pending;
+}
+
+bool CommandBuffer::empty() const { return pending == 0; }
+
+void CommandBuffer::clear() {
+  created.clear();
+  destroyed.clear();
+  parentOps.clear();
+  for (auto &q : queues) {
+    if (q)
+      q->clear();
+  }
+  pending = 0;
+}
+
+} // namespace engine
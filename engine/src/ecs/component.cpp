@@ -1,4 +1,5 @@
 #include "engine/ecs/component.hpp"
+#include <algorithm>
 
 namespace engine {
 
@@ -25,9 +26,45 @@ ComponentSerializerRegistry &ComponentManager::getSerializerRegistry() {
   return serializerRegistry;
 }
 
+void ComponentManager::destroy(Entity entity) {
+  assertUnlocked();
+  if (mode == StorageMode::Archetype) {
+    if (Archetype *archetype = archetypes.archetypeOf(entity)) {
+      for (const ComponentInfo *info : archetype->signature())
+        logRemoval(info->typeId, entity);
+    }
+    archetypes.destroy(entity);
+    return;
+  }
+  for (std::size_t id = 0; id < storages.size(); ++id) {
+    if (storages[id] && storages[id]->remove(entity))
+      logRemoval(id, entity);
+  }
+}
+
+void ComponentManager::logRemoval(std::size_t typeId, Entity entity) {
+  if (typeId >= removed.size())
+    removed.resize(typeId + 1);
+  removed[typeId].push_back({entity, ticks.current});
+}
+
+void ComponentManager::trimRemoved(uint32_t tick) {
+  for (auto &log : removed) {
+    log.erase(std::remove_if(log.begin(), log.end(),
+                             [tick](const Removal &removal) {
+                               return removal.tick <= tick;
+                             }),
+              log.end());
+  }
+}
+
 void ComponentManager::clearStorages() {
-  for (auto &[type, storagePtr] : storages) {
-    storagePtr->clear();
+  assertUnlocked();
+  for (auto &storage : storages) {
+    if (storage)
+      storage->clear();
   }
+  archetypes.clear();
+  removed.clear();
 }
 } // namespace engine
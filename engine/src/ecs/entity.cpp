@@ -0,0 +1,113 @@
+#include "engine/ecs/entity.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace engine {
+
+Entity EntityRegistry::create() {
+  Entity entity = reserve();
+  return activate(entityIndex(entity), entityGeneration(entity));
+}
+
+Entity EntityRegistry::create(Entity requested) {
+  uint32_t index = entityIndex(requested);
+  if (index == 0)
+    return NullEntity;
+  if (index < aliveSlot.size() && aliveSlot[index] != Dead)
+    return NullEntity;
+
+  std::lock_guard<std::mutex> lock(freeMutex);
+  uint32_t next = nextIndex.load();
+  while (index >= next && !nextIndex.compare_exchange_weak(next, index + 1)) {
+  }
+  if (index >= next) {
+    for (uint32_t skipped = next; skipped < index; ++skipped)
+      freeList.push_back(makeEntity(skipped, 0));
+  } else {
+    // A dead slot below nextIndex is either free, or reserved and waiting
+    // for materialize(), or retired. Only a free one can be taken.
+    auto it = std::find_if(freeList.begin(), freeList.end(),
+                           [index](Entity free) {
+                             return entityIndex(free) == index;
+                           });
+    if (it == freeList.end())
+      return NullEntity;
+    freeList.erase(it);
+  }
+  return activate(index, entityGeneration(requested));
+}
+
+Entity EntityRegistry::reserve() {
+  {
+    std::lock_guard<std::mutex> lock(freeMutex);
+    if (freeList.size() >= MinFreeSlots) {
+      Entity entity = freeList.front();
+      freeList.pop_front();
+      return entity;
+    }
+  }
+  return reserveFresh();
+}
+
+Entity EntityRegistry::reserveFresh() {
+  uint32_t index = nextIndex.fetch_add(1);
+  if (index > EntityIndexMask)
+    throw std::length_error("Too many entities");
+  return makeEntity(index, 0);
+}
+
+void EntityRegistry::materialize(Entity reserved) {
+  uint32_t index = entityIndex(reserved);
+  if (index >= aliveSlot.size() || aliveSlot[index] == Dead)
+    activate(index, entityGeneration(reserved));
+}
+
+Entity EntityRegistry::activate(uint32_t index, uint32_t generation) {
+  if (index >= generations.size()) {
+    generations.resize(index + 1, 0);
+    aliveSlot.resize(index + 1, Dead);
+  }
+
+  Entity entity = makeEntity(index, generation);
+  generations[index] = generation;
+  aliveSlot[index] = static_cast<uint32_t>(entities.size());
+  entities.push_back(entity);
+  return entity;
+}
+
+void EntityRegistry::destroy(Entity entity) {
+  if (!alive(entity))
+    return;
+
+  uint32_t index = entityIndex(entity);
+  uint32_t slot = aliveSlot[index];
+  Entity last = entities.back();
+  entities[slot] = last;
+  aliveSlot[entityIndex(last)] = slot;
+  entities.pop_back();
+
+  aliveSlot[index] = Dead;
+  // retired, the next generation would wrap to handles already given out
+  if (generations[index] == EntityGenerationMask)
+    return;
+  ++generations[index];
+  std::lock_guard<std::mutex> lock(freeMutex);
+  freeList.push_back(makeEntity(index, generations[index]));
+}
+
+bool EntityRegistry::alive(Entity entity) const {
+  uint32_t index = entityIndex(entity);
+  return index != 0 && index < generations.size() &&
+         aliveSlot[index] != Dead && generations[index] == entityGeneration(entity);
+}
+
+void EntityRegistry::clear() {
+  nextIndex.store(1);
+  generations.assign(1, 0);
+  aliveSlot.assign(1, Dead);
+  std::lock_guard<std::mutex> lock(freeMutex);
+  freeList.clear();
+  entities.clear();
+}
+
+} // namespace engine
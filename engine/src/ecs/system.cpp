@@ -1,23 +1,182 @@
 #include "engine/ecs/system.hpp"
 #include "engine/core/world.hpp"
+#include "engine/core/jobSystem.hpp"
+#include "engine/ecs/changeTick.hpp"
+#include "engine/engineContext.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <typeindex>
+
 namespace engine {
 
-    void SystemManager::addSystem(std::shared_ptr<System> system) {
-        systems.push_back(system);
-    }
+bool SystemAccess::conflicts(const SystemAccess &other) const {
+  if (!_declared || !other._declared)
+    return true;
+  for (std::size_t type : writes) {
+    if (contains(other.reads, type) || contains(other.writes, type))
+      return true;
+  }
+  for (std::size_t type : other.writes) {
+    if (contains(reads, type))
+      return true;
+  }
+  return false;
+}
 
-    void SystemManager::updateAll(World& world, float dt) {
-        for (auto& system : systems) {
-            system->update(world, dt);
+bool SystemAccess::canRead(std::size_t typeId) const {
+  return contains(reads, typeId) || contains(writes, typeId);
+}
 
-        }
+bool SystemAccess::canWrite(std::size_t typeId) const {
+  return contains(writes, typeId);
+}
+
+void SystemAccess::fail(const char *what, std::size_t typeId) {
+  throw std::runtime_error(std::string("System access violation: ") + what +
+                           std::to_string(typeId));
+}
+
+void SystemManager::addSystem(std::shared_ptr<System> system) {
+  access.emplace_back();
+  system->declareAccess(access.back());
+  systems.push_back(system);
+  lastRun.push_back(0);
+  scheduled = false;
+}
+
+void SystemManager::schedule(World &world) {
+  std::size_t count = systems.size();
+  std::vector<std::vector<std::size_t>> edges(count);
+  std::vector<std::size_t> incoming(count, 0);
+  auto edge = [&](std::size_t from, std::size_t to) {
+    edges[from].push_back(to);
+    ++incoming[to];
+  };
+
+  // a before b if either side asks for it
+  auto constrained = [this](std::size_t a, std::size_t b) {
+    std::type_index aType(typeid(*systems[a])), bType(typeid(*systems[b]));
+    const auto &before = access[a]._before, &after = access[b]._after;
+    return std::find(before.begin(), before.end(), bType) != before.end() ||
+           std::find(after.begin(), after.end(), aType) != after.end();
+  };
+
+  for (std::size_t a = 0; a < count; ++a) {
+    for (std::size_t b = a + 1; b < count; ++b) {
+      bool aFirst = constrained(a, b);
+      bool bFirst = constrained(b, a);
+      if (!aFirst && !bFirst && access[a].conflicts(access[b]))
+        aFirst = true; // registration order
+      if (aFirst)
+        edge(a, b);
+      if (bFirst)
+        edge(b, a);
     }
+  }
 
-    void SystemManager::startAll(World& world) {
-        for (auto& system : systems) {
-            system->start(world);
+  // Each wave holds the systems whose predecessors all ran in earlier waves
+  waves.clear();
+  std::vector<std::size_t> ready;
+  for (std::size_t i = 0; i < count; ++i) {
+    if (incoming[i] == 0)
+      ready.push_back(i);
+  }
+  std::size_t placed = 0;
+  while (!ready.empty()) {
+    std::stable_partition(ready.begin(), ready.end(), [this](std::size_t i) {
+      return access[i]._mainThread;
+    });
+    placed += ready.size();
+    std::vector<std::size_t> following;
+    for (std::size_t i : ready) {
+      for (std::size_t next : edges[i]) {
+        if (--incoming[next] == 0)
+          following.push_back(next);
+      }
+    }
+    std::sort(following.begin(), following.end());
+    waves.push_back(std::move(ready));
+    ready = std::move(following);
+  }
+  if (placed != count)
+    throw std::runtime_error("System ordering constraints form a cycle");
+
+  for (const SystemAccess &declared : access) {
+    for (auto prepare : declared.prepare)
+      prepare(world);
+  }
+  scheduled = true;
+}
+
+void SystemManager::runOne(std::size_t index,
+                           const std::function<void(System &)> &call) {
+  // restored on exit, a system may drive another world's systems
+  SystemContext::Scope scope(
+      {access[index].declared() ? &access[index] : nullptr, lastRun[index]});
+  call(*systems[index]);
+}
+
+void SystemManager::run(World &world,
+                        const std::function<void(System &)> &call) {
+  if (!scheduled)
+    schedule(world);
+
+  JobSystem *jobs = world.getContext() ? world.getContext()->jobs : nullptr;
+  for (const auto &wave : waves) {
+    uint32_t tick = world.advanceChangeTick();
+
+    if (wave.size() == 1 || !jobs) {
+      for (std::size_t i : wave)
+        runOne(i, call);
+    } else {
+      std::exception_ptr error;
+      std::mutex errorMutex;
+      auto guarded = [&](std::size_t i) {
+        try {
+          runOne(i, call);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(errorMutex);
+          if (!error)
+            error = std::current_exception();
         }
+      };
+
+      // main-thread systems come first in the wave
+      JobSystem::Counter counter;
+      for (std::size_t i : wave) {
+        if (!access[i]._mainThread)
+          jobs->run([&guarded, i] { guarded(i); }, &counter);
+      }
+      for (std::size_t i : wave) {
+        if (access[i]._mainThread)
+          guarded(i);
+      }
+      jobs->wait(counter);
+      if (error)
+        std::rethrow_exception(error);
     }
 
+    // commands get a tick newer than the wave's, so its systems see what
+    // they recorded next time, through Added<> and Changed<> too
+    world.advanceChangeTick();
+    world.flushCommands();
+    for (std::size_t i : wave)
+      lastRun[i] = tick;
+  }
+  // changes made between runs must be newer than every system's last run
+  world.advanceChangeTick();
+}
+
+void SystemManager::updateAll(World &world, float dt) {
+  run(world, [&world, dt](System &system) { system.update(world, dt); });
+}
+
+void SystemManager::startAll(World &world) {
+  run(world, [&world](System &system) { system.start(world); });
+}
 
-}  
+} // namespace engine
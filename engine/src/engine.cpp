@@ -3,7 +3,7 @@
 #include <iostream>
 namespace engine {
 
-Engine::Engine() {}
+Engine::Engine(StorageMode storageMode) : _world(storageMode) {}
 
 Engine::~Engine() { shutdown(); }
 
@@ -14,11 +14,12 @@ void Engine::init(int width, int height, const char *title) {
   }
 
   context = new EngineContext();
-  _world = World();
   renderer = new Renderer(width, height, title);
   controller = new Controller(); 
+  jobs = new JobSystem();
   inputManager = InputManager();
   context->controller = controller;
+  context->jobs = jobs;
  
   _world.registerDefaults();
 
@@ -63,6 +64,8 @@ void Engine::shutdown() {
   _running = false;
   delete controller;
   controller = nullptr;
+  delete jobs;
+  jobs = nullptr;
   delete renderer;
   renderer = nullptr; 
   delete context;
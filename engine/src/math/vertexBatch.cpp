@@ -0,0 +1,221 @@
+#include "engine/math/vertexBatch.hpp"
+#include <cstring>
+
+namespace engine::math {
+
+static uint8_t outcode(float x, float y, float z, float w) {
+  return (x < -w ? OutLeft : 0) | (x > w ? OutRight : 0) |
+         (y < -w ? OutBottom : 0) | (y > w ? OutTop : 0) |
+         (z < -w ? OutNear : 0) | (z > w ? OutFar : 0);
+}
+
+#if defined(ENGINE_MATH_AVX)
+// one clip-space component for 8 vertices, same order as Mat4 * Vec4 with
+// the w = 1 term adding c3 unscaled
+static inline __m256 row(__m256 c0, __m256 c1, __m256 c2, __m256 c3,
+                         __m256 x, __m256 y, __m256 z) {
+  __m256 sum = _mm256_mul_ps(c0, x);
+  sum = _mm256_add_ps(sum, _mm256_mul_ps(c1, y));
+  sum = _mm256_add_ps(sum, _mm256_mul_ps(c2, z));
+  return _mm256_add_ps(sum, c3);
+}
+#endif
+
+#if defined(ENGINE_MATH_SSE)
+static inline __m128 row(__m128 c0, __m128 c1, __m128 c2, __m128 c3,
+                         __m128 x, __m128 y, __m128 z) {
+  __m128 sum = _mm_mul_ps(c0, x);
+  sum = _mm_add_ps(sum, _mm_mul_ps(c1, y));
+  sum = _mm_add_ps(sum, _mm_mul_ps(c2, z));
+  return _mm_add_ps(sum, c3);
+}
+#endif
+
+void transformPositions(const Mat4 &m, const float *x, const float *y,
+                        const float *z, std::size_t count, ClipVertices &out) {
+  // stores through these could alias m as far as the compiler knows, so the
+  // matrix is copied and the broadcasts hoisted out of the loops
+  const Mat4 mat = m;
+  float *ox = out.x.data();
+  float *oy = out.y.data();
+  float *oz = out.z.data();
+  float *ow = out.w.data();
+  uint8_t *codes = out.outcodes.data();
+  std::size_t i = 0;
+
+#if defined(ENGINE_MATH_AVX)
+  {
+    __m256 col[4][4];
+    for (int c = 0; c < 4; ++c)
+      for (int r = 0; r < 4; ++r)
+        col[c][r] = _mm256_set1_ps(mat[c][r]);
+    auto bit = [](__m256 mask, int value) {
+      return _mm256_and_ps(mask, _mm256_castsi256_ps(_mm256_set1_epi32(value)));
+    };
+
+    for (; i + 8 <= count; i += 8) {
+      __m256 vx = _mm256_loadu_ps(x + i);
+      __m256 vy = _mm256_loadu_ps(y + i);
+      __m256 vz = _mm256_loadu_ps(z + i);
+      __m256 cx = row(col[0][0], col[1][0], col[2][0], col[3][0], vx, vy, vz);
+      __m256 cy = row(col[0][1], col[1][1], col[2][1], col[3][1], vx, vy, vz);
+      __m256 cz = row(col[0][2], col[1][2], col[2][2], col[3][2], vx, vy, vz);
+      __m256 cw = row(col[0][3], col[1][3], col[2][3], col[3][3], vx, vy, vz);
+      _mm256_storeu_ps(ox + i, cx);
+      _mm256_storeu_ps(oy + i, cy);
+      _mm256_storeu_ps(oz + i, cz);
+      _mm256_storeu_ps(ow + i, cw);
+
+      __m256 negW = _mm256_sub_ps(_mm256_setzero_ps(), cw);
+      __m256 bits = _mm256_or_ps(
+          _mm256_or_ps(bit(_mm256_cmp_ps(cx, negW, _CMP_LT_OQ), OutLeft),
+                       bit(_mm256_cmp_ps(cx, cw, _CMP_GT_OQ), OutRight)),
+          _mm256_or_ps(
+              bit(_mm256_cmp_ps(cy, negW, _CMP_LT_OQ), OutBottom),
+              bit(_mm256_cmp_ps(cy, cw, _CMP_GT_OQ), OutTop)));
+      bits = _mm256_or_ps(
+          bits,
+          _mm256_or_ps(bit(_mm256_cmp_ps(cz, negW, _CMP_LT_OQ), OutNear),
+                       bit(_mm256_cmp_ps(cz, cw, _CMP_GT_OQ), OutFar)));
+      // 32-bit lanes to bytes, all values fit
+      __m256i lanes = _mm256_castps_si256(bits);
+      __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(lanes),
+                                       _mm256_extractf128_si256(lanes, 1));
+      packed = _mm_packus_epi16(packed, packed);
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(codes + i), packed);
+    }
+  }
+#endif
+
+#if defined(ENGINE_MATH_SSE)
+  {
+    __m128 col[4][4];
+    for (int c = 0; c < 4; ++c)
+      for (int r = 0; r < 4; ++r)
+        col[c][r] = _mm_set1_ps(mat[c][r]);
+    auto bit = [](__m128 mask, int value) {
+      return _mm_and_si128(_mm_castps_si128(mask), _mm_set1_epi32(value));
+    };
+
+    for (; i + 4 <= count; i += 4) {
+      __m128 vx = _mm_loadu_ps(x + i);
+      __m128 vy = _mm_loadu_ps(y + i);
+      __m128 vz = _mm_loadu_ps(z + i);
+      __m128 cx = row(col[0][0], col[1][0], col[2][0], col[3][0], vx, vy, vz);
+      __m128 cy = row(col[0][1], col[1][1], col[2][1], col[3][1], vx, vy, vz);
+      __m128 cz = row(col[0][2], col[1][2], col[2][2], col[3][2], vx, vy, vz);
+      __m128 cw = row(col[0][3], col[1][3], col[2][3], col[3][3], vx, vy, vz);
+      _mm_storeu_ps(ox + i, cx);
+      _mm_storeu_ps(oy + i, cy);
+      _mm_storeu_ps(oz + i, cz);
+      _mm_storeu_ps(ow + i, cw);
+
+      __m128 negW = _mm_sub_ps(_mm_setzero_ps(), cw);
+      __m128i bits = _mm_or_si128(
+          _mm_or_si128(bit(_mm_cmplt_ps(cx, negW), OutLeft),
+                       bit(_mm_cmpgt_ps(cx, cw), OutRight)),
+          _mm_or_si128(bit(_mm_cmplt_ps(cy, negW), OutBottom),
+                       bit(_mm_cmpgt_ps(cy, cw), OutTop)));
+      bits = _mm_or_si128(
+          bits, _mm_or_si128(bit(_mm_cmplt_ps(cz, negW), OutNear),
+                             bit(_mm_cmpgt_ps(cz, cw), OutFar)));
+      bits = _mm_packs_epi32(bits, bits);
+      bits = _mm_packus_epi16(bits, bits);
+      int32_t packed = _mm_cvtsi128_si32(bits);
+      std::memcpy(codes + i, &packed, sizeof(packed));
+    }
+  }
+#endif
+
+  for (; i < count; ++i) {
+    float cx = mat[0][0] * x[i] + mat[1][0] * y[i] + mat[2][0] * z[i] +
+               mat[3][0];
+    float cy = mat[0][1] * x[i] + mat[1][1] * y[i] + mat[2][1] * z[i] +
+               mat[3][1];
+    float cz = mat[0][2] * x[i] + mat[1][2] * y[i] + mat[2][2] * z[i] +
+               mat[3][2];
+    float cw = mat[0][3] * x[i] + mat[1][3] * y[i] + mat[2][3] * z[i] +
+               mat[3][3];
+    ox[i] = cx;
+    oy[i] = cy;
+    oz[i] = cz;
+    ow[i] = cw;
+    codes[i] = outcode(cx, cy, cz, cw);
+  }
+}
+
+void projectToScreen(const ClipVertices &clip, float width, float height,
+                     ScreenVertices &out) {
+  const float *cx = clip.x.data();
+  const float *cy = clip.y.data();
+  const float *cz = clip.z.data();
+  const float *cw = clip.w.data();
+  float *sx = out.x.data();
+  float *sy = out.y.data();
+  float *sz = out.z.data();
+  std::size_t count = clip.size();
+  std::size_t i = 0;
+
+  // Divisions rather than multiplies by 1 / w, so the results match the
+  // scalar x / w exactly. Halving is exact either way.
+#if defined(ENGINE_MATH_AVX)
+  {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 behind = _mm256_set1_ps(-1.0f);
+    const __m256 w8 = _mm256_set1_ps(width);
+    const __m256 h8 = _mm256_set1_ps(height);
+    for (; i + 8 <= count; i += 8) {
+      __m256 w = _mm256_loadu_ps(cw + i);
+      __m256 front = _mm256_cmp_ps(w, _mm256_setzero_ps(), _CMP_GT_OQ);
+      __m256 nx = _mm256_div_ps(_mm256_loadu_ps(cx + i), w);
+      __m256 ny = _mm256_div_ps(_mm256_loadu_ps(cy + i), w);
+      __m256 nz = _mm256_div_ps(_mm256_loadu_ps(cz + i), w);
+      __m256 px = _mm256_mul_ps(_mm256_mul_ps(w8, _mm256_add_ps(nx, one)), half);
+      __m256 py = _mm256_mul_ps(_mm256_mul_ps(h8, _mm256_sub_ps(one, ny)), half);
+      _mm256_storeu_ps(sx + i, _mm256_blendv_ps(behind, px, front));
+      _mm256_storeu_ps(sy + i, _mm256_blendv_ps(behind, py, front));
+      _mm256_storeu_ps(sz + i, _mm256_blendv_ps(behind, nz, front));
+    }
+  }
+#endif
+
+#if defined(ENGINE_MATH_SSE)
+  {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 behind = _mm_set1_ps(-1.0f);
+    const __m128 w4 = _mm_set1_ps(width);
+    const __m128 h4 = _mm_set1_ps(height);
+    // SSE2 has no blend, select through and/andnot
+    auto select = [](__m128 mask, __m128 a, __m128 b) {
+      return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    };
+    for (; i + 4 <= count; i += 4) {
+      __m128 w = _mm_loadu_ps(cw + i);
+      __m128 front = _mm_cmpgt_ps(w, _mm_setzero_ps());
+      __m128 nx = _mm_div_ps(_mm_loadu_ps(cx + i), w);
+      __m128 ny = _mm_div_ps(_mm_loadu_ps(cy + i), w);
+      __m128 nz = _mm_div_ps(_mm_loadu_ps(cz + i), w);
+      __m128 px = _mm_mul_ps(_mm_mul_ps(w4, _mm_add_ps(nx, one)), half);
+      __m128 py = _mm_mul_ps(_mm_mul_ps(h4, _mm_sub_ps(one, ny)), half);
+      _mm_storeu_ps(sx + i, select(front, px, behind));
+      _mm_storeu_ps(sy + i, select(front, py, behind));
+      _mm_storeu_ps(sz + i, select(front, nz, behind));
+    }
+  }
+#endif
+
+  for (; i < count; ++i) {
+    float w = cw[i];
+    if (!(w > 0.0f)) {
+      sx[i] = sy[i] = sz[i] = -1.0f;
+      continue;
+    }
+    sx[i] = width * (cx[i] / w + 1) / 2;
+    sy[i] = height * (1 - cy[i] / w) / 2;
+    sz[i] = cz[i] / w;
+  }
+}
+
+} // namespace engine::math
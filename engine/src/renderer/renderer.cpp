@@ -3,10 +3,12 @@
 #include "SDL_render.h"
 #include "engine/assets/mesh.hpp"
 #include "engine/components/components.hpp"
+#include "engine/core/jobSystem.hpp"
 #include "engine/core/world.hpp"
 #include "engine/math/general.hpp"
 #include "engine/math/mat4.hpp"
 #include "engine/math/vec4.hpp"
+#include "engine/math/vertexBatch.hpp"
 #include <SDL2/SDL.h>
 #include <algorithm>
 #include <cmath>
@@ -39,6 +41,13 @@ Renderer::Renderer(int width, int height, const char *title)
 
   framebuffer = new uint32_t[screenWidth * screenHeight];
   zBuffer.resize(screenWidth * screenHeight);
+  hiZWidth = (screenWidth + HiZBlock - 1) / HiZBlock;
+  hiZ.resize(hiZWidth * ((screenHeight + HiZBlock - 1) / HiZBlock));
+  visibility.assign(screenWidth * screenHeight, NoTriangle);
+
+  tilesX = (screenWidth + TileSize - 1) / TileSize;
+  tilesY = (screenHeight + TileSize - 1) / TileSize;
+  bins.resize(tilesX * tilesY);
 }
 
 Renderer::~Renderer() {
@@ -62,12 +71,21 @@ void Renderer::clear(uint32_t color) {
   Uint8 skyG = 206;
   Uint8 skyB = 235;
 
+  // queued triangles would be cleared away anyway
+  droppedTriangles = 0;
+  draws.clear();
+  triangles.clear();
+  for (std::vector<uint32_t> &bin : bins)
+    bin.clear();
+
   Uint32 clearColor = (skyR << 16) | (skyG << 8) | skyB;
   std::fill(framebuffer, framebuffer + screenWidth * screenHeight, clearColor);
   std::fill(zBuffer.begin(), zBuffer.end(), std::numeric_limits<float>::max());
+  std::fill(hiZ.begin(), hiZ.end(), std::numeric_limits<float>::max());
 }
 
 void Renderer::present() {
+  flush();
   SDL_UpdateTexture(sdlTexture, nullptr, framebuffer,
                     screenWidth * sizeof(uint32_t));
   SDL_RenderClear(sdlRenderer);
@@ -79,11 +97,14 @@ void Renderer::present() {
 Vec3 Renderer::project(const Vec4 &point, const Mat4 &globalMat,
                        const Mat4 &viewM, const Mat4 &perspM) const {
   Vec4 projected4 = perspM * viewM * globalMat * point;
- 
-  if (projected4.w <= 0.0f)
+  return toScreen(projected4.x, projected4.y, projected4.z, projected4.w);
+}
+
+Vec3 Renderer::toScreen(float x, float y, float z, float w) const {
+  if (w <= 0.0f)
     return Vec3(-1, -1, -1);
 
-  Vec3 pr = projected4.toVec3();
+  Vec3 pr = Vec4(x, y, z, w).toVec3();
   return Vec3(screenWidth * (pr.x + 1) / 2, screenHeight * (1 - pr.y) / 2, pr.z);
 }
 
@@ -111,166 +132,688 @@ auto isValid = [](const Vec3 &v) {
   return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z);
 };
 
-void Renderer::drawTriangle(const Mesh *mesh, const Triangle &tri,
-                            const std::vector<Vec3> &vertices,
-                            const Mat4 &globalMat,
-                            const TransformComponent &cameraTransform,
-                            const CameraComponent &camera,
-                            const MaterialComponent &material) {
-  Vec3 v0 = vertices[tri.i0];
-  Vec3 v1 = vertices[tri.i1];
-  Vec3 v2 = vertices[tri.i2];
-  Vec4 v04 = Vec4(v0.x, v0.y, v0.z, 1);
-  Vec4 v14 = Vec4(v1.x, v1.y, v1.z, 1);
-  Vec4 v24 = Vec4(v2.x, v2.y, v2.z, 1);
+// Allowance for rounding in the interpolated depth when testing a triangle's
+// nearest corner against the hierarchical z-buffer
+static constexpr float HiZBias = 1e-5f;
+
+// Clip space x, y beyond +-GuardBand * w get clipped, anything inside is
+// rasterized as is and scissored to the screen. Keeps screen coordinates
+// small enough for float edge functions.
+static constexpr float GuardBand = 8.0f;
+
+// Planes a triangle may need clipping against. Near is z = 0 rather than
+// the frustum's z = -w, it is where the depth range of the z-buffer starts.
+enum GuardPlane : uint8_t {
+  GuardNear = 1,
+  GuardLeft = 2,
+  GuardRight = 4,
+  GuardBottom = 8,
+  GuardTop = 16,
+  GuardPlaneCount = 5,
+};
+
+static uint8_t guardCode(float x, float y, float z, float w) {
+  float band = GuardBand * w;
+  return (z < 0 ? GuardNear : 0) | (x < -band ? GuardLeft : 0) |
+         (x > band ? GuardRight : 0) | (y < -band ? GuardBottom : 0) |
+         (y > band ? GuardTop : 0);
+}
 
+// Signed distance to a guard plane, >= 0 inside
+static float guardDistance(uint8_t plane, const Vec4 &p) {
+  switch (plane) {
+  case GuardNear:
+    return p.z;
+  case GuardLeft:
+    return GuardBand * p.w + p.x;
+  case GuardRight:
+    return GuardBand * p.w - p.x;
+  case GuardBottom:
+    return GuardBand * p.w + p.y;
+  default:
+    return GuardBand * p.w - p.y;
+  }
+}
 
-  Vec3 forward, right, up;
-  math::updateCameraBasis(cameraTransform.rotation, forward, right, up);
+namespace {
+// Triangle corner during clipping, attributes are linear in clip space
+struct ClipCorner {
+  Vec4 clip;
+  Vec3 position;
+  Vec3 uv;
+  Vec3 normal;
+
+  ClipCorner lerp(const ClipCorner &to, float t) const {
+    return {clip + (to.clip - clip) * t, position + (to.position - position) * t,
+            uv + (to.uv - uv) * t, normal + (to.normal - normal) * t};
+  }
+};
+} // namespace
 
-  Mat4 viewM = Mat4::lookAt(cameraTransform.position,
-                            cameraTransform.position + forward, Vec3(0, 1, 0));
-  Mat4 perspM = Mat4::perspective(camera.fov, camera.aspectRatio,
-                                  camera.nearPlane, camera.farPlane);
+void Renderer::drawTriangle(const Mesh *mesh, const Triangle &tri,
+                            const math::ClipVertices &clip,
+                            const math::ScreenVertices &screen,
+                            const Mat4x3 &normalMat, const RenderView &view,
+                            const MaterialComponent &material) {
+  // all three corners beyond the same frustum plane
+  if (clip.outcodes[tri.i0] & clip.outcodes[tri.i1] & clip.outcodes[tri.i2])
+    return;
 
+  const int index[3] = {tri.i0, tri.i1, tri.i2};
+  uint8_t guard[3];
+  for (int k = 0; k < 3; ++k) {
+    int i = index[k];
+    guard[k] = guardCode(clip.x[i], clip.y[i], clip.z[i], clip.w[i]);
+  }
+  if (guard[0] & guard[1] & guard[2])
+    return;
 
+  Vec3 v0 = mesh->vertices[tri.i0];
+  Vec3 v1 = mesh->vertices[tri.i1];
+  Vec3 v2 = mesh->vertices[tri.i2];
 
   Vec3 normal = (v1 - v0).cross(v2 - v0);
 
 
-  Vec3 normalWorld = (globalMat * Vec4(normal, 0.0f)).toVec3().normalized();
+  Vec3 normalWorld = normalMat.transformVector(normal).normalized();
 
 
-  if (normalWorld.dot(forward) > 0.2f) {
+  if (normalWorld.dot(view.forward) > 0.2f) {
     return;
   }
 
+  Vec3 uv[3];
+  if (material.useTexture) {
+    uv[0] = mesh->textureMap[tri.uv0];
+    uv[1] = mesh->textureMap[tri.uv1];
+    uv[2] = mesh->textureMap[tri.uv2];
+  }
 
-  Vec3 p0 = project(v04, globalMat, viewM, perspM);
-  Vec3 p1 = project(v14, globalMat, viewM, perspM);
-  Vec3 p2 = project(v24, globalMat, viewM, perspM);
+  // flat shading, the normal and light terms are the same for every pixel
+  TriangleShading shading;
+  Vec3 normalViewSpace =
+      (view.view * Vec4(normalWorld, 0.0f)).toVec3().normalized();
+  Vec3 toLight = view.lightDirView * -1;
+  shading.diffuse = std::max(material.ambient, normalViewSpace.dot(toLight));
+  shading.reflectDir = reflect(toLight, normalViewSpace);
+
+  Vec3 normals[3];
+  if (draws.back().features & SmoothNormals) {
+    for (int k = 0; k < 3; ++k) {
+      Vec3 n = normalMat.transformVector(mesh->normals[index[k]]);
+      normals[k] = (view.view * Vec4(n, 0.0f)).toVec3().normalized();
+    }
+  }
 
-  if (p0.z < 0.0f || p0.z > 1.0f || p0.x < 0 || p0.x >= screenWidth ||
-      p0.y < 0 || p0.y >= screenHeight)
-    return;
-  if (p1.z < 0.0f || p1.z > 1.0f || p1.x < 0 || p1.x >= screenWidth ||
-      p1.y < 0 || p1.y >= screenHeight)
-    return;
-  if (p2.z < 0.0f || p2.z > 1.0f || p2.x < 0 || p2.x >= screenWidth ||
-      p2.y < 0 || p2.y >= screenHeight)
+  // Common case: in front of the near plane and inside the guard band, the
+  // projected corners are used as they are
+  uint8_t crossed = guard[0] | guard[1] | guard[2];
+  if (!crossed) {
+    RasterVertex corners[3];
+    for (int k = 0; k < 3; ++k) {
+      int i = index[k];
+      // w is positive in front of the near plane unless it is NaN, which
+      // projectToScreen turns into the finite behind-the-camera corner
+      if (!(clip.w[i] > 0)) {
+        ++droppedTriangles;
+        return;
+      }
+      corners[k] = {Vec3(screen.x[i], screen.y[i], screen.z[i]),
+                    mesh->vertices[i], uv[k], normals[k]};
+    }
+    binTriangle(corners[0], corners[1], corners[2], shading);
     return;
+  }
+
+  // Sutherland-Hodgman against the planes the triangle crosses, each one
+  // adds at most one corner
+  constexpr int MaxCorners = 3 + GuardPlaneCount;
+  ClipCorner polygons[2][MaxCorners];
+  ClipCorner *in = polygons[0], *out = polygons[1];
+  int count = 3;
+  for (int k = 0; k < 3; ++k) {
+    int i = index[k];
+    in[k] = {Vec4(clip.x[i], clip.y[i], clip.z[i], clip.w[i]),
+             mesh->vertices[i], uv[k], normals[k]};
+  }
+
+  for (uint8_t plane = GuardNear; plane <= GuardTop; plane <<= 1) {
+    if (!(crossed & plane))
+      continue;
+    int kept = 0;
+    for (int k = 0; k < count; ++k) {
+      const ClipCorner &cur = in[k];
+      const ClipCorner &next = in[(k + 1) % count];
+      float dCur = guardDistance(plane, cur.clip);
+      float dNext = guardDistance(plane, next.clip);
+      if (dCur >= 0)
+        out[kept++] = cur;
+      if ((dCur >= 0) != (dNext >= 0))
+        out[kept++] = cur.lerp(next, dCur / (dCur - dNext));
+    }
+    std::swap(in, out);
+    count = kept;
+    if (count < 3)
+      return;
+  }
+
+  RasterVertex corners[MaxCorners];
+  for (int k = 0; k < count; ++k) {
+    const Vec4 &c = in[k].clip;
+    corners[k] = {toScreen(c.x, c.y, c.z, c.w), in[k].position, in[k].uv,
+                  in[k].normal};
+  }
+  // the clipped polygon is convex, fan it out from the first corner
+  for (int k = 1; k + 1 < count; ++k)
+    binTriangle(corners[0], corners[k], corners[k + 1], shading);
+}
+
+void Renderer::binTriangle(const RasterVertex &c0, const RasterVertex &c1,
+                           const RasterVertex &c2,
+                           const TriangleShading &shading) {
+  const Vec3 &p0 = c0.screen;
+  const Vec3 &p1 = c1.screen;
+  const Vec3 &p2 = c2.screen;
 
+  // Clipping keeps w positive, so only NaN or infinite vertices or
+  // matrices fail this
   if (!isValid(p0) || !isValid(p1) || !isValid(p2)) {
-    std::cout << "Skipping triangle due to invalid projection values\n";
+    ++droppedTriangles;
     return;
   }
 
-  Vec3 uv0;
-  Vec3 uv1;
-  Vec3 uv2;
-  if (material.useTexture) {
-    uv0 = mesh->textureMap[tri.uv0];
-    uv1 = mesh->textureMap[tri.uv1];
-    uv2 = mesh->textureMap[tri.uv2];
-  }
+  // bounding box scissored to the screen, corners may be off it
   float minX = std::min({p0.x, p1.x, p2.x});
   float maxX = std::max({p0.x, p1.x, p2.x});
   float minY = std::min({p0.y, p1.y, p2.y});
   float maxY = std::max({p0.y, p1.y, p2.y});
 
-  int minXInt = std::max(0, static_cast<int>(std::floor(minX)));
-  int maxXInt = std::min(screenWidth - 1, static_cast<int>(std::ceil(maxX)));
-  int minYInt = std::max(0, static_cast<int>(std::floor(minY)));
-  int maxYInt = std::min(screenHeight - 1, static_cast<int>(std::ceil(maxY)));
+  SetupTriangle t;
+  t.minX = std::max(0, static_cast<int>(std::floor(minX)));
+  t.maxX = std::min(screenWidth - 1, static_cast<int>(std::ceil(maxX)));
+  t.minY = std::max(0, static_cast<int>(std::floor(minY)));
+  t.maxY = std::min(screenHeight - 1, static_cast<int>(std::ceil(maxY)));
+  if (t.minX > t.maxX || t.minY > t.maxY)
+    return;
 
   float area = edgeFunction(p0, p1, p2);
   if (std::abs(area) < 1e-6f) {
     return;
   }
 
-  Vec3 lightDirViewSpace = (viewM * Vec4(lightDir, 0.0f)).toVec3().normalized();
-  for (int y = minYInt; y <= maxYInt; ++y) {
-    for (int x = minXInt; x <= maxXInt; ++x) {
-      Vec3 c(x, y, 0);
-
-      float w0 = edgeFunction(p1, p2, c);
-      float w1 = edgeFunction(p2, p0, c);
-      float w2 = edgeFunction(p0, p1, c);
-
-      if (w0 >= 0 && w1 >= 0 && w2 >= 0) {
-
-        float alpha = w0 / area;
-        float beta = w1 / area;
-        float gamma = w2 / area;
+  t.corners[0] = c0;
+  t.corners[1] = c1;
+  t.corners[2] = c2;
+  t.shading = shading;
+  t.invArea = 1.0f / area;
+  if (triangles.size() - draws.back().firstTriangle == MaxDrawTriangles) {
+    // out of triangle ids for this draw, finish what is queued and carry on
+    Draw current = draws.back();
+    flush();
+    current.firstTriangle = 0;
+    draws.push_back(current);
+  }
+  t.draw = static_cast<uint32_t>(draws.size() - 1);
+  t.id = packId(t.draw, static_cast<uint32_t>(triangles.size() -
+                                              draws.back().firstTriangle));
+
+  uint32_t index = static_cast<uint32_t>(triangles.size());
+  triangles.push_back(t);
+  for (int ty = t.minY / TileSize; ty <= t.maxY / TileSize; ++ty)
+    for (int tx = t.minX / TileSize; tx <= t.maxX / TileSize; ++tx)
+      bins[ty * tilesX + tx].push_back(index);
+}
 
-        float depth = alpha * p0.z + beta * p1.z + gamma * p2.z;
-        if (!std::isfinite(depth) || depth < 0 || depth > 1) {
-          continue;
-        }
+void Renderer::flush(JobSystem *jobs) {
+  if (triangles.empty())
+    return;
 
-        Vec3 worldPos = v0 * alpha + v1 * beta + v2 * gamma;
+  auto rasterTiles = [&](std::size_t first, std::size_t last) {
+    for (std::size_t tile = first; tile < last; ++tile)
+      rasterTile(tile);
+  };
+  if (jobs)
+    jobs->parallelFor(0, bins.size(), rasterTiles, 1);
+  else
+    rasterTiles(0, bins.size());
+
+  draws.clear();
+  triangles.clear();
+  for (std::vector<uint32_t> &bin : bins)
+    bin.clear();
+}
 
-        Vec3 finalColor = material.baseColor;
+void Renderer::rasterTile(std::size_t tile) {
+  int x0 = static_cast<int>(tile % tilesX) * TileSize;
+  int y0 = static_cast<int>(tile / tilesX) * TileSize;
+  int x1 = std::min(x0 + TileSize, screenWidth) - 1;
+  int y1 = std::min(y0 + TileSize, screenHeight) - 1;
+  bool deferred = shadingMode == ShadingMode::Visibility;
+  for (uint32_t index : bins[tile]) {
+    const SetupTriangle &t = triangles[index];
+    const Draw &draw = draws[t.draw];
+    (this->*(deferred ? draw.rasterDeferred : draw.raster))(t, x0, y0, x1, y1);
+  }
+  if (deferred)
+    resolveTile(x0, y0, x1, y1);
+}
 
-        if (material.useTexture && material.texture) {
-          float u = alpha * uv0.x + beta * uv1.x + gamma * uv2.x;
-          float v = alpha * uv0.y + beta * uv1.y + gamma * uv2.y;
+void Renderer::SetupTriangle::edges(int x, int y, float &w0, float &w1,
+                                    float &w2) const {
+  const Vec3 &p0 = corners[0].screen;
+  const Vec3 &p1 = corners[1].screen;
+  const Vec3 &p2 = corners[2].screen;
+  float fx = static_cast<float>(x);
+  float fy = static_cast<float>(y);
+  w0 = (p2.x - p1.x) * (fy - p1.y) - (p2.y - p1.y) * (fx - p1.x);
+  w1 = (p0.x - p2.x) * (fy - p2.y) - (p0.y - p2.y) * (fx - p2.x);
+  w2 = (p1.x - p0.x) * (fy - p0.y) - (p1.y - p0.y) * (fx - p0.x);
+}
 
-          Uint32 texColor = material.texture->sample(u, v);
+void Renderer::resolveTile(int x0, int y0, int x1, int y1) {
+  for (int y = y0; y <= y1; ++y) {
+    for (int x = x0; x <= x1; ++x) {
+      int index = y * screenWidth + x;
+      uint32_t id = visibility[index];
+      if (id == NoTriangle)
+        continue;
+      visibility[index] = NoTriangle;
+
+      const Draw &draw = draws[id >> TriangleIdBits];
+      const SetupTriangle &t =
+          triangles[draw.firstTriangle + (id & (MaxDrawTriangles - 1))];
+      float w0, w1, w2;
+      t.edges(x, y, w0, w1, w2);
+      framebuffer[index] = (this->*draw.shade)(t, w0 * t.invArea,
+                                               w1 * t.invArea, w2 * t.invArea);
+    }
+  }
+}
 
-          Uint8 r = (texColor >> 16) & 0xFF;
-          Uint8 g = (texColor >> 8) & 0xFF;
-          Uint8 b = texColor & 0xFF;
+template <int Features>
+void Renderer::rasterTriangle(const SetupTriangle &t, int x0, int y0, int x1,
+                              int y1) {
+  const bool depthTest = uses<Features>(draws[t.draw], DepthTested);
+  const Vec3 &p0 = t.corners[0].screen;
+  const Vec3 &p1 = t.corners[1].screen;
+  const Vec3 &p2 = t.corners[2].screen;
+  const float invArea = t.invArea;
+
+  int minXInt = std::max(t.minX, x0);
+  int maxXInt = std::min(t.maxX, x1);
+  int minYInt = std::max(t.minY, y0);
+  int maxYInt = std::min(t.maxY, y1);
+
+  // Colors one covered pixel from its edge function values, or only records
+  // its depth and id when shading is deferred, unless it fails the depth
+  // test. Returns whether its depth was written.
+  auto shade = [&](int x, int y, float w0, float w1, float w2) {
+    float alpha = w0 * invArea;
+    float beta = w1 * invArea;
+    float gamma = w2 * invArea;
+
+    float depth = alpha * p0.z + beta * p1.z + gamma * p2.z;
+    if (!std::isfinite(depth) || depth < 0 || depth > 1) {
+      return false;
+    }
+    // early depth test, hidden pixels skip the shading
+    int index = y * screenWidth + x;
+    if (depthTest) {
+      if (!(depth < zBuffer[index]))
+        return false;
+      zBuffer[index] = depth;
+    }
+    if constexpr ((Features & Deferred) != 0)
+      visibility[index] = t.id;
+    else
+      framebuffer[index] =
+          shadePixel<Features & (Textured | Specular | SmoothNormals | Dynamic)>(
+              t, alpha, beta, gamma);
+    return depthTest;
+  };
+
+  // Edge functions w = dx * (y - oy) - dy * (x - ox), the operations of
+  // edgeFunction, so a pixel's coverage doesn't depend on the walk. The y
+  // term is set up once per row, x steps through spans of SIMD lanes.
+  const float ox[3] = {p1.x, p2.x, p0.x};
+  const float oy[3] = {p1.y, p2.y, p0.y};
+  const float dx[3] = {p2.x - p1.x, p0.x - p2.x, p1.x - p0.x};
+  const float dy[3] = {p2.y - p1.y, p0.y - p2.y, p1.y - p0.y};
+
+  // Shades the covered pixels of row y in [first, last]
+  auto span = [&](int y, float row0, float row1, float row2, int first,
+                  int last) {
+    bool written = false;
+    int x = first;
+#if defined(ENGINE_MATH_AVX)
+    {
+      const __m256 lanes = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+      const __m256 zero = _mm256_setzero_ps();
+      const __m256 lastX = _mm256_set1_ps(static_cast<float>(last));
+      auto edge = [](float row, float dy, float ox, __m256 px) {
+        return _mm256_sub_ps(
+            _mm256_set1_ps(row),
+            _mm256_mul_ps(_mm256_set1_ps(dy),
+                          _mm256_sub_ps(px, _mm256_set1_ps(ox))));
+      };
+      for (; x <= last; x += 8) {
+        __m256 px =
+            _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lanes);
+        __m256 w0 = edge(row0, dy[0], ox[0], px);
+        __m256 w1 = edge(row1, dy[1], ox[1], px);
+        __m256 w2 = edge(row2, dy[2], ox[2], px);
+        __m256 covered = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(w0, zero, _CMP_GE_OQ),
+                          _mm256_cmp_ps(w1, zero, _CMP_GE_OQ)),
+            _mm256_and_ps(_mm256_cmp_ps(w2, zero, _CMP_GE_OQ),
+                          _mm256_cmp_ps(px, lastX, _CMP_LE_OQ)));
+        int mask = _mm256_movemask_ps(covered);
+        if (!mask)
+          continue;
+        alignas(32) float e0[8], e1[8], e2[8];
+        _mm256_store_ps(e0, w0);
+        _mm256_store_ps(e1, w1);
+        _mm256_store_ps(e2, w2);
+        for (int l = 0; l < 8; ++l)
+          if (mask & (1 << l))
+            written |= shade(x + l, y, e0[l], e1[l], e2[l]);
+      }
+    }
+#elif defined(ENGINE_MATH_SSE)
+    {
+      const __m128 lanes = _mm_setr_ps(0, 1, 2, 3);
+      const __m128 zero = _mm_setzero_ps();
+      const __m128 lastX = _mm_set1_ps(static_cast<float>(last));
+      auto edge = [](float row, float dy, float ox, __m128 px) {
+        return _mm_sub_ps(
+            _mm_set1_ps(row),
+            _mm_mul_ps(_mm_set1_ps(dy), _mm_sub_ps(px, _mm_set1_ps(ox))));
+      };
+      for (; x <= last; x += 4) {
+        __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lanes);
+        __m128 w0 = edge(row0, dy[0], ox[0], px);
+        __m128 w1 = edge(row1, dy[1], ox[1], px);
+        __m128 w2 = edge(row2, dy[2], ox[2], px);
+        __m128 covered =
+            _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)),
+                       _mm_and_ps(_mm_cmpge_ps(w2, zero), _mm_cmple_ps(px, lastX)));
+        int mask = _mm_movemask_ps(covered);
+        if (!mask)
+          continue;
+        alignas(16) float e0[4], e1[4], e2[4];
+        _mm_store_ps(e0, w0);
+        _mm_store_ps(e1, w1);
+        _mm_store_ps(e2, w2);
+        for (int l = 0; l < 4; ++l)
+          if (mask & (1 << l))
+            written |= shade(x + l, y, e0[l], e1[l], e2[l]);
+      }
+    }
+#endif
+
+    for (; x <= last; ++x) {
+      float fx = static_cast<float>(x);
+      float w0 = row0 - dy[0] * (fx - ox[0]);
+      float w1 = row1 - dy[1] * (fx - ox[1]);
+      float w2 = row2 - dy[2] * (fx - ox[2]);
+      if (w0 >= 0 && w1 >= 0 && w2 >= 0)
+        written |= shade(x, y, w0, w1, w2);
+    }
+    return written;
+  };
+
+  // Interpolated depths are convex combinations of the corners' when
+  // invArea > 0, so none lies nearer than the nearest corner, less a bias
+  // for rounding. A block whose farthest depth is no farther than that can't
+  // pass any depth test and is skipped; so is a triangle, once all of its
+  // blocks are.
+  const float nearest = depthTest && invArea > 0
+                            ? std::min({p0.z, p1.z, p2.z}) - HiZBias
+                            : -std::numeric_limits<float>::max();
+  constexpr int BlocksPerTile = TileSize / HiZBlock;
+  int firstBlockX = minXInt / HiZBlock;
+  int lastBlockX = maxXInt / HiZBlock;
+
+  for (int blockY = minYInt / HiZBlock; blockY <= maxYInt / HiZBlock;
+       ++blockY) {
+    bool open[BlocksPerTile];
+    bool written[BlocksPerTile] = {};
+    bool any = false;
+    for (int b = firstBlockX; b <= lastBlockX; ++b) {
+      open[b - firstBlockX] = nearest < hiZ[blockY * hiZWidth + b];
+      any |= open[b - firstBlockX];
+    }
+    if (!any)
+      continue;
+
+    int firstY = std::max(minYInt, blockY * HiZBlock);
+    int lastY = std::min(maxYInt, blockY * HiZBlock + HiZBlock - 1);
+    for (int y = firstY; y <= lastY; ++y) {
+      float fy = static_cast<float>(y);
+      float row0 = dx[0] * (fy - oy[0]);
+      float row1 = dx[1] * (fy - oy[1]);
+      float row2 = dx[2] * (fy - oy[2]);
+      for (int b = firstBlockX; b <= lastBlockX; ++b) {
+        if (!open[b - firstBlockX])
+          continue;
+        int first = std::max(minXInt, b * HiZBlock);
+        int last = std::min(maxXInt, b * HiZBlock + HiZBlock - 1);
+        written[b - firstBlockX] |= span(y, row0, row1, row2, first, last);
+      }
+    }
 
-          finalColor = Vec3(r / 255.0f, g / 255.0f, b / 255.0f);
-        }
+    for (int b = firstBlockX; b <= lastBlockX; ++b)
+      if (written[b - firstBlockX])
+        updateHiZ(b, blockY);
+  }
+}
 
+template <int Features>
+uint32_t Renderer::shadePixel(const SetupTriangle &t, float alpha, float beta,
+                              float gamma) const {
+  const TriangleShading &shading = t.shading;
+  const Draw &draw = draws[t.draw];
+  const MaterialComponent &material = draw.material;
 
-        Vec3 normalViewSpace = (viewM * Vec4(normalWorld, 0.0f)).toVec3().normalized();
+  Vec3 finalColor = material.baseColor;
 
-        // Ambient + diffuse lighting
-        float diffIntensity = std::max(material.ambient, normalViewSpace.dot(lightDirViewSpace*-1));
+  if (uses<Features>(draw, Textured)) {
+    const Vec3 &uv0 = t.corners[0].uv;
+    const Vec3 &uv1 = t.corners[1].uv;
+    const Vec3 &uv2 = t.corners[2].uv;
+    float u = alpha * uv0.x + beta * uv1.x + gamma * uv2.x;
+    float v = alpha * uv0.y + beta * uv1.y + gamma * uv2.y;
 
+    Uint32 texColor = material.texture->sample(u, v);
 
-        Vec3 viewDir = (cameraTransform.position - worldPos).normalized();
+    Uint8 r = (texColor >> 16) & 0xFF;
+    Uint8 g = (texColor >> 8) & 0xFF;
+    Uint8 b = texColor & 0xFF;
 
-        // Reflection direction for specular
-        Vec3 reflectDir = reflect(lightDirViewSpace*-1, normalViewSpace);
+    finalColor = Vec3(r / 255.0f, g / 255.0f, b / 255.0f);
+  }
 
-        // Specular intensity
-        float spec = pow(std::max(0.0f, viewDir.dot(reflectDir)), material.shininess);
+  float diffuse = shading.diffuse;
+  Vec3 reflectDir = shading.reflectDir;
+  if (uses<Features>(draw, SmoothNormals)) {
+    Vec3 n = (t.corners[0].normal * alpha + t.corners[1].normal * beta +
+              t.corners[2].normal * gamma)
+                 .normalized();
+    diffuse = std::max(material.ambient, n.dot(draw.toLight));
+    reflectDir = draw.toLight - n * (2.0f * draw.toLight.dot(n));
+  }
 
-        // Total light intensity combining ambient, diffuse, specular
-        float totalLight = diffIntensity + material.specular * spec;
+  // Total light intensity combining ambient, diffuse, specular
+  float totalLight = diffuse;
+  if (uses<Features>(draw, Specular)) {
+    Vec3 worldPos = t.corners[0].position * alpha +
+                    t.corners[1].position * beta +
+                    t.corners[2].position * gamma;
+    Vec3 viewDir = (draw.cameraPos - worldPos).normalized();
+
+    // Specular intensity
+    float spec = pow(std::max(0.0f, viewDir.dot(reflectDir)), material.shininess);
+    totalLight = diffuse + material.specular * spec;
+  }
 
+  Vec3 litColor = finalColor * totalLight;
 
-        Vec3 litColor = finalColor * totalLight;
+  Uint8 r = static_cast<Uint8>(std::clamp(litColor.x * 255.0f, 0.0f, 255.0f));
+  Uint8 g = static_cast<Uint8>(std::clamp(litColor.y * 255.0f, 0.0f, 255.0f));
+  Uint8 b = static_cast<Uint8>(std::clamp(litColor.z * 255.0f, 0.0f, 255.0f));
+  return (r << 16) | (g << 8) | b;
+}
 
-        Uint8 r = static_cast<Uint8>(std::clamp(litColor.x * 255.0f, 0.0f, 255.0f));
-        Uint8 g = static_cast<Uint8>(std::clamp(litColor.y * 255.0f, 0.0f, 255.0f));
-        Uint8 b = static_cast<Uint8>(std::clamp(litColor.z * 255.0f, 0.0f, 255.0f));
+void Renderer::choosePipeline(Draw &draw, int features) const {
+  // indexed by the features each variant is built for
+  static const RasterFn forward[] = {
+      &Renderer::rasterTriangle<0>,  &Renderer::rasterTriangle<1>,
+      &Renderer::rasterTriangle<2>,  &Renderer::rasterTriangle<3>,
+      &Renderer::rasterTriangle<4>,  &Renderer::rasterTriangle<5>,
+      &Renderer::rasterTriangle<6>,  &Renderer::rasterTriangle<7>,
+      &Renderer::rasterTriangle<8>,  &Renderer::rasterTriangle<9>,
+      &Renderer::rasterTriangle<10>, &Renderer::rasterTriangle<11>,
+      &Renderer::rasterTriangle<12>, &Renderer::rasterTriangle<13>,
+      &Renderer::rasterTriangle<14>, &Renderer::rasterTriangle<15>,
+  };
+  static const ShadeFn shaders[] = {
+      &Renderer::shadePixel<0>, &Renderer::shadePixel<1>,
+      &Renderer::shadePixel<2>, &Renderer::shadePixel<3>,
+      &Renderer::shadePixel<4>, &Renderer::shadePixel<5>,
+      &Renderer::shadePixel<6>, &Renderer::shadePixel<7>,
+  };
+
+  draw.features = features;
+  if (!specialized) {
+    draw.raster = &Renderer::rasterTriangle<Dynamic>;
+    draw.rasterDeferred = &Renderer::rasterTriangle<Dynamic | Deferred>;
+    draw.shade = &Renderer::shadePixel<Dynamic>;
+    return;
+  }
+  draw.raster = forward[features];
+  draw.rasterDeferred = features & DepthTested
+                            ? &Renderer::rasterTriangle<Deferred | DepthTested>
+                            : &Renderer::rasterTriangle<Deferred>;
+  draw.shade = shaders[features & (Textured | Specular | SmoothNormals)];
+}
 
-        Uint32 color = (r << 16) | (g << 8) | b;
+void Renderer::updateHiZ(int blockX, int blockY) {
+  int x0 = blockX * HiZBlock;
+  int y0 = blockY * HiZBlock;
+  int x1 = std::min(x0 + HiZBlock, screenWidth);
+  int y1 = std::min(y0 + HiZBlock, screenHeight);
+  float farthest = 0.0f;
+  for (int y = y0; y < y1; ++y) {
+    const float *row = zBuffer.data() + y * screenWidth;
+    for (int x = x0; x < x1; ++x)
+      farthest = std::max(farthest, row[x]);
+  }
+  hiZ[blockY * hiZWidth + blockX] = farthest;
+}
 
-        drawPixel(x, y, depth, color);
-      }
-    }
+RenderView Renderer::prepareView(const Mat4 &cameraMat,
+                                 const CameraComponent &camera) const {
+  RenderView view;
+  view.view = math::viewFromWorld(cameraMat);
+  view.projection = Mat4::perspective(camera.fov, camera.aspectRatio,
+                                      camera.nearPlane, camera.farPlane);
+  view.viewProjection = view.projection * view.view;
+
+  view.cameraPos = math::extractPosition(cameraMat);
+  view.forward =
+      Vec3(cameraMat[2][0], cameraMat[2][1], cameraMat[2][2]).normalized();
+
+  // planes from the rows of the view-projection, -w <= x, y, z <= w inside
+  const Mat4 &vp = view.viewProjection;
+  Vec4 w = vp.getRow(3);
+  for (int axis = 0; axis < 3; ++axis) {
+    Vec4 row = vp.getRow(axis);
+    view.frustum[axis * 2] = w + row;
+    view.frustum[axis * 2 + 1] = w - row;
   }
+  for (Vec4 &plane : view.frustum) {
+    float length = Vec3(plane.x, plane.y, plane.z).length();
+    plane = plane * (1.0f / length);
+  }
+
+  view.lightDirView =
+      (view.view * Vec4(lightDir, 0.0f)).toVec3().normalized();
+  return view;
 }
 
-void Renderer::renderMesh(const Mesh *mesh, const Mat4 &globalMat,
-                          const TransformComponent &cameraTransform,
-                          const CameraComponent &camera,
+void Renderer::renderMesh(const Mesh *mesh, const GlobalTransform &global,
+                          const RenderView &view,
                           const MaterialComponent &material) {
   if (!mesh) {
 
     return;
   }
 
+  // a mesh wholly outside the frustum would lose every triangle to the
+  // outcode test anyway
+  const Mat4 &model = global.worldMatrix;
+  if (mesh->boundsRadius >= 0) {
+    Vec4 center = model * Vec4(mesh->boundsCenter, 1.0f);
+    float scale = std::max({Vec3(model[0][0], model[0][1], model[0][2]).length(),
+                            Vec3(model[1][0], model[1][1], model[1][2]).length(),
+                            Vec3(model[2][0], model[2][1], model[2][2]).length()});
+    if (!view.sphereVisible(Vec3(center.x, center.y, center.z),
+                            mesh->boundsRadius * scale))
+      return;
+  }
+
   SDL_SetRenderDrawColor(sdlRenderer, 255, 255, 255, 255);
+  // out of draw ids. Checked in forward mode too, the ids are packed either
+  // way and the mode may switch to visibility before the flush.
+  if (draws.size() == MaxDraws)
+    flush();
+  Draw draw;
+  draw.material = material;
+  draw.cameraPos = view.cameraPos;
+  draw.toLight = view.lightDirView * -1;
+  draw.firstTriangle = static_cast<uint32_t>(triangles.size());
+  int features = 0;
+  if (material.useTexture && material.texture)
+    features |= Textured;
+  if (material.specular != 0.0f)
+    features |= Specular;
+  if (material.smoothShading && mesh->normals.size() == mesh->vertices.size())
+    features |= SmoothNormals;
+  if (material.depthTest)
+    features |= DepthTested;
+  choosePipeline(draw, features);
+  draws.push_back(draw);
+
+  // Vertex stage: every vertex to clip and screen space once, triangles
+  // index into the results. Same floats as project().
+  Mat4 mvp = view.viewProjection * model;
+
+  std::size_t count = mesh->vertices.size();
+  clip.resize(count);
+  if (mesh->hasSoA()) {
+    math::transformPositions(mvp, mesh->xs.data(), mesh->ys.data(),
+                             mesh->zs.data(), count, clip);
+  } else {
+    soaX.resize(count);
+    soaY.resize(count);
+    soaZ.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      soaX[i] = mesh->vertices[i].x;
+      soaY[i] = mesh->vertices[i].y;
+      soaZ[i] = mesh->vertices[i].z;
+    }
+    math::transformPositions(mvp, soaX.data(), soaY.data(), soaZ.data(), count,
+                             clip);
+  }
+
+  screen.resize(count);
+  math::projectToScreen(clip, static_cast<float>(screenWidth),
+                        static_cast<float>(screenHeight), screen);
+
+  // inverse-transpose, so normals stay perpendicular under non-uniform scale
+  const Mat4x3 &normalMat = global.normalMatrix();
   for (const Triangle &tri : mesh->triangles) {
-    drawTriangle(mesh, tri, mesh->vertices, globalMat, cameraTransform, camera,
-                 material);
+    drawTriangle(mesh, tri, clip, screen, normalMat, view, material);
   }
 }
 //
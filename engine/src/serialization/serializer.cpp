@@ -1,4 +1,5 @@
 #include "engine/serialization/serializer.hpp"
+#include "engine/components/components.hpp"
 #include "engine/core/world.hpp"
 #include "engine/thirdparty/nlohmann/json.hpp"
 #include <fstream>
@@ -9,6 +10,7 @@ namespace engine {
 
 void Serializer::saveScene(World &world, const std::string &filepath) {
   json scene;
+  scene["version"] = SceneVersion;
   scene["activeCamera"] = world.getCamera();
   scene["entities"] = json::array();
 
@@ -41,7 +43,10 @@ void Serializer::loadScene(World &world, const std::string &filepath) {
   world.clearStorages();
 
   for (const auto &entityJson : scene["entities"]) {
-    Entity e = world.createEntity();
+    // Keep saved ids so components referring to other entities stay valid
+    Entity e = entityJson.contains("id")
+                   ? world.createEntityWithId(entityJson["id"].get<Entity>())
+                   : world.createEntity();
 
     const auto &componentsJson = entityJson["components"];
     for (const auto &[componentName, componentData] : componentsJson.items()) {
@@ -53,6 +58,17 @@ void Serializer::loadScene(World &world, const std::string &filepath) {
     }
   }
   world.setCameraEntity(scene["activeCamera"]);
+
+  // Version 1 views looked up for a positive pitch, now a positive rotation
+  // about X turns the camera's +Z down
+  if (scene.value("version", 1) < 2) {
+    for (auto [e, camera, transform] :
+         world.view<const CameraComponent, TransformComponent>()) {
+      Vec3 euler = transform.getEuler();
+      euler.x = -euler.x;
+      transform.setEuler(euler);
+    }
+  }
 }
 
 } // namespace engine
@@ -1,7 +1,10 @@
 #include "engine/systems/systems.hpp"
 
 #include "engine/components/components.hpp"
+#include "engine/core/jobSystem.hpp"
 #include "engine/core/world.hpp"
+#include "engine/engineContext.hpp"
+#include "engine/ecs/commandBuffer.hpp"
 #include "engine/ecs/system.hpp"
 #include "engine/math/general.hpp"
 #include "engine/math/mat4.hpp"
@@ -14,76 +17,178 @@ namespace engine {
 using Entity = uint32_t;
 
 void RenderSystem::update(World &world, float dt) {
-  const auto &entities = world.getEntities();
-
   Entity cameraEntity = world.getCamera();
 
   if (!cameraEntity || cameraEntity <= 0)
     return;
 
   auto &cameraGM =
-      world.getComponent<GlobalTransform>(cameraEntity).worldMatrix;
+      world.getComponent<const GlobalTransform>(cameraEntity).worldMatrix;
 
-  auto &camera = world.getComponent<CameraComponent>(cameraEntity);
+  auto &camera = world.getComponent<const CameraComponent>(cameraEntity);
+  RenderView view = renderer->prepareView(cameraGM, camera);
 
-  TransformComponent cameraGlobalT = math::transformFromMatrix(cameraGM);
-  for (Entity entity : entities) {
-    if (world.hasComponent<GlobalTransform>(entity) &&
-        world.hasComponent<MeshComponent>(entity) &&
-        world.hasComponent<MaterialComponent>(entity)) {
+  world.view<const GlobalTransform, const MeshComponent,
+             const MaterialComponent>()
+      .each([&](const GlobalTransform &global, const MeshComponent &meshC,
+                const MaterialComponent &material) {
+        if (!meshC.mesh)
+          return;
 
-      Mat4 &globalMat = world.getComponent<GlobalTransform>(entity).worldMatrix;
-      auto &meshC = world.getComponent<MeshComponent>(entity);
-      if (!meshC.mesh)
-        continue;
-      auto &material = world.getComponent<MaterialComponent>(entity);
+        renderer->renderMesh(meshC.mesh.get(), global, view, material);
+      });
 
-      renderer->renderMesh(meshC.mesh.get(), globalMat, cameraGlobalT, camera,
-                           material);
-    }
-  }
+  EngineContext *context = world.getContext();
+  renderer->flush(context ? context->jobs : nullptr);
+}
+
+void RenderSystem::declareAccess(SystemAccess &access) {
+  access.read<GlobalTransform>()
+      .read<MeshComponent>()
+      .read<MaterialComponent>()
+      .read<CameraComponent>()
+      .mainThread();
 }
 
 void ScriptSystem::update(World &world, float dt) {
-  const auto &entities = world.getEntities();
-  for (Entity entity : entities) {
-    if (world.hasComponent<ScriptComponent>(entity)) {
-      auto &sc = world.getComponent<ScriptComponent>(entity);
-      sc.script->update(dt);
-    }
-  }
+  scripts.clear();
+  world.view<ScriptComponent>().each(
+      [&](ScriptComponent &sc) { scripts.push_back(sc.script); });
+  for (const ScriptPtr &script : scripts)
+    script->update(dt);
 }
 
 void ScriptSystem::start(World &world) {
-
-  auto &entities = world.getEntities();
-  for (Entity entity : entities) {
-    if (world.hasComponent<ScriptComponent>(entity)) {
-      auto &sc = world.getComponent<ScriptComponent>(entity);
-      sc.script->start();
-    }
-  }
+  scripts.clear();
+  world.view<ScriptComponent>().each(
+      [&](ScriptComponent &sc) { scripts.push_back(sc.script); });
+  for (const ScriptPtr &script : scripts)
+    script->start();
 }
 
-void processEntity(World &world, Entity e, const Mat4 &parentMatrix) {
-  auto &local = world.getComponent<TransformComponent>(e);
-  Mat4 localMat = Mat4::modelMatrix(local);
-
-  Mat4 globalMat = parentMatrix * localMat;
-  world.getComponent<GlobalTransform>(e).worldMatrix = globalMat;
+void HierarchySystem::update(World &world, float dt) {
+  TransformHierarchy &hierarchy = world.getHierarchy();
+  dirty.clear();
+  ranges.clear();
+
+  // World keeps the hierarchy in sync, this only catches ParentComponents
+  // edited directly (scene loading). Re-parented or detached subtrees need
+  // new world matrices. A link that would make a cycle is removed instead.
+  world.view<Changed<const ParentComponent>>().each(
+      [&](Entity e, const ParentComponent &link) {
+        uint32_t index = hierarchy.indexOf(e);
+        uint32_t parent = index == TransformHierarchy::None
+                              ? TransformHierarchy::None
+                              : hierarchy.parentOf(index);
+        bool linked = parent != TransformHierarchy::None &&
+                      hierarchy.entityAt(parent) == link.parent;
+        if (!linked && world.isAlive(link.parent)) {
+          if (hierarchy.inSubtree(link.parent, e)) {
+            world.commands().removeParent(e);
+            return;
+          }
+          hierarchy.attach(e, link.parent);
+        }
+        dirty.push_back(e);
+      });
+  world.eachRemoved<ParentComponent>([&](Entity e) {
+    if (!world.isAlive(e) || world.hasComponent<ParentComponent>(e))
+      return;
+    hierarchy.detach(e);
+    dirty.push_back(e);
+  });
+
+  // Moved entities get a new local matrix
+  world.view<Changed<const TransformComponent>>().each(
+      [&](Entity e, const TransformComponent &transform) {
+        hierarchy.insert(e);
+        hierarchy.localMatrix(hierarchy.indexOf(e)) =
+            Mat4::modelMatrix(transform);
+        dirty.push_back(e);
+      });
+
+  // Drops destroyed entities' nodes and restores the order after the
+  // attach/detach calls since the last frame. Subtrees are then contiguous,
+  // so each dirty entity is a range of nodes and nested ranges are covered
+  // by their outermost one.
+  hierarchy.compact();
+  for (Entity e : dirty) {
+    uint32_t index = hierarchy.indexOf(e);
+    if (index != TransformHierarchy::None)
+      ranges.emplace_back(index, index + hierarchy.subtreeSize(index));
+  }
+  std::sort(ranges.begin(), ranges.end());
+  std::size_t kept = 0;
+  uint32_t done = 0;
+  for (auto range : ranges) {
+    if (range.second <= done)
+      continue;
+    ranges[kept++] = range;
+    done = range.second;
+  }
+  ranges.resize(kept);
+
+  auto updateRanges = [&](std::size_t first, std::size_t last) {
+    for (std::size_t r = first; r < last; ++r) {
+      auto [begin, end] = ranges[r];
+      hierarchy.update(begin, end);
+      for (uint32_t i = begin; i < end; ++i) {
+        Entity e = hierarchy.entityAt(i);
+        if (world.hasComponent<GlobalTransform>(e))
+          world.getComponent<GlobalTransform>(e).set(
+              hierarchy.worldMatrix(i));
+      }
+    }
+  };
 
-  for (Entity child : world.getChildren(e)) {
-    processEntity(world, child, globalMat);
+  JobSystem *jobs = world.getContext() ? world.getContext()->jobs : nullptr;
+  if (!jobs || jobs->threadCount() == 1 || ranges.size() < 2) {
+    updateRanges(0, ranges.size());
+    return;
   }
-}
 
-void HierarchySystem::update(World &world, float dt) {
-  for (Entity e : world.getEntities()) {
-    if (!world.hasComponent<ParentComponent>(e)) {
-      // This is a root node
-      processEntity(world, e, Mat4::identity());
+  // The ranges are separate subtrees that only read matrices outside all of
+  // them, so they can run concurrently. Batches of consecutive ranges with
+  // about the same node count keep the jobs balanced; every node is still
+  // computed exactly as in the serial pass.
+  std::size_t nodes = 0;
+  for (auto [begin, end] : ranges)
+    nodes += end - begin;
+  std::size_t target = std::max<std::size_t>(
+      MinBatchNodes, nodes / (jobs->threadCount() * 4));
+  batches.assign(1, 0);
+  std::size_t filled = 0;
+  for (std::size_t r = 0; r < ranges.size(); ++r) {
+    filled += ranges[r].second - ranges[r].first;
+    if (filled >= target) {
+      batches.push_back(r + 1);
+      filled = 0;
     }
   }
+  if (batches.back() != ranges.size())
+    batches.push_back(ranges.size());
+
+  SystemContext context = SystemContext::capture();
+  jobs->parallelFor(
+      0, batches.size() - 1,
+      [&](std::size_t first, std::size_t last) {
+        SystemContext::Scope scope(context);
+        updateRanges(batches[first], batches[last]);
+      },
+      1);
+}
+
+void HierarchySystem::declareAccess(SystemAccess &access) {
+  access.read<TransformComponent>()
+      .read<ParentComponent>()
+      .read<ChildrenComponent>()
+      .write<GlobalTransform>();
+}
+
+void CameraControllerSystem::declareAccess(SystemAccess &access) {
+  access.read<CameraControllerComponent>()
+      .read<CameraComponent>()
+      .write<TransformComponent>();
 }
 
 void CameraControllerSystem::update(World &world, float dt) {
@@ -109,11 +214,9 @@ void CameraControllerSystem::update(World &world, float dt) {
 
   moveDir = moveDir.normalized();
 
-  for (Entity e : world.view<CameraControllerComponent, TransformComponent,
-                             CameraComponent>()) {
-
-    auto &transform = world.getComponent<TransformComponent>(e);
-    auto &cameraC = world.getComponent<CameraControllerComponent>(e);
+  for (auto [e, cameraC, transform, camera] :
+       world.view<const CameraControllerComponent, TransformComponent,
+                  const CameraComponent>()) {
 
     Vec3 forward, right, up;
     math::updateCameraBasis(transform.rotation, forward, right, up);
@@ -124,11 +227,14 @@ void CameraControllerSystem::update(World &world, float dt) {
             cameraC.speed * dt;
 
     if (controller->rightClick) {
+      Vec3 euler = transform.getEuler();
 
-      transform.rotation.y += controller->dx * cameraC.sens * dt;
+      euler.y += controller->dx * cameraC.sens * dt;
 
-      transform.rotation.x -= controller->dy * cameraC.sens * dt;
-      transform.rotation.x = std::clamp(transform.rotation.x, -1.5f, 1.5f);
+      // positive pitch about X turns the local +Z view direction down
+      euler.x += controller->dy * cameraC.sens * dt;
+      euler.x = std::clamp(euler.x, -1.5f, 1.5f);
+      transform.setEuler(euler);
     }
   }
   controller->dx = 0;
@@ -7,25 +7,24 @@ using namespace engine;
 
 // Example Script: Rotator
 class Rotator : public Script {
-  TransformComponent *transform = nullptr;
   EngineContext *ctx = nullptr;
 
 public:
   Rotator() : Script("Rotator") {}
 
   void start() override {
-    // Get the GameObject wrapper for this script's entity
-    GameObject obj = getGameObject();
-    transform = &obj.getComponent<TransformComponent>();
-
     // Get the engine context (for input, etc)
     ctx = world->getContext();
   }
 
   void update(float dt) override {
     if (ctx && ctx->controller->isKeyPressed(Key::Escape)) {
-      // Rotate around Y axis continuously while Escape key is pressed
-      transform->rotation.y += dt;
+      // Rotate around Y axis continuously while Escape key is pressed. Looked
+      // up every frame: the mutable access is what marks the transform as
+      // changed for HierarchySystem
+      auto &transform = getComponent<TransformComponent>();
+      transform.rotation =
+          Quat::fromAxisAngle(Vec3(0, 1, 0), dt) * transform.rotation;
     }
   }
 };
@@ -0,0 +1,128 @@
+// What Added<>, Changed<> and eachRemoved report to systems over several
+// frames: an added component is Added and Changed once, a mutable
+// getComponent in a later frame makes it Changed but not Added, a const one
+// does nothing, and a removal reaches every system exactly once. Both
+// storage modes report the same.
+//
+//   make tests
+#include <engine/core/jobSystem.hpp>
+#include <engine/core/world.hpp>
+#include <engine/ecs/commandBuffer.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace engine;
+
+struct Position {
+  float x = 0;
+};
+
+static std::string list(std::vector<Entity> entities) {
+  std::sort(entities.begin(), entities.end());
+  std::string out = "[";
+  for (Entity e : entities)
+    out += (out.size() > 1 ? " " : "") + std::to_string(e);
+  return out + "]";
+}
+
+// Writes one Position per frame, frame 1 a mutable and a const access,
+// frame 2 a removal
+class Writer : public System {
+public:
+  void start(World &) override {}
+  void update(World &world, float) override {
+    if (frame == 1) {
+      world.getComponent<Position>(entities[0]).x += 1;
+      world.getComponent<const Position>(entities[1]);
+    } else if (frame == 2) {
+      world.commands().removeComponent<Position>(entities[2]);
+    }
+    ++frame;
+  }
+  void declareAccess(SystemAccess &access) override {
+    access.write<Position>();
+  }
+
+  std::vector<Entity> entities;
+  int frame = 0;
+};
+
+// Logs what the change filters show it every frame
+class Observer : public System {
+public:
+  void start(World &) override {}
+  void update(World &world, float) override {
+    std::vector<Entity> added, changed, removed;
+    world.view<Added<const Position>>().each(
+        [&](Entity e, const Position &) { added.push_back(e); });
+    world.view<Changed<const Position>>().each(
+        [&](Entity e, const Position &) { changed.push_back(e); });
+    world.eachRemoved<Position>([&](Entity e) { removed.push_back(e); });
+    log += "added " + list(added) + " changed " + list(changed) +
+           " removed " + list(removed) + "\n";
+  }
+  void declareAccess(SystemAccess &access) override {
+    access.read<Position>().after<Writer>();
+  }
+
+  std::string log;
+};
+
+static std::string expected(const std::vector<Entity> &e) {
+  std::string all = list({e[0], e[1], e[2]});
+  return "added " + all + " changed " + all + " removed []\n" +
+         "added [] changed " + list({e[0]}) + " removed []\n" +
+         "added [] changed [] removed " + list({e[2]}) + "\n" +
+         "added [] changed [] removed []\n";
+}
+
+static bool run(StorageMode mode, const char *name, JobSystem *jobs,
+                std::string &log) {
+  EngineContext context;
+  context.jobs = jobs;
+  World world(mode);
+  world.setContext(&context);
+  auto writer = std::make_shared<Writer>();
+  auto first = std::make_shared<Observer>();
+  auto second = std::make_shared<Observer>();
+  world.addSystem(writer);
+  world.addSystem(first);
+  world.addSystem(second);
+
+  for (int i = 0; i < 3; ++i) {
+    Entity e = world.createEntity();
+    world.addComponent(e, Position{float(i)});
+    writer->entities.push_back(e);
+  }
+  for (int frame = 0; frame < 4; ++frame)
+    world.updateSystems(0.f);
+
+  std::string want = expected(writer->entities);
+  bool ok = first->log == want && second->log == want;
+  std::printf("%-9s %-6s two observers: %s\n", name, jobs ? "jobs" : "serial",
+              ok ? "ok" : "FAILED");
+  if (!ok)
+    std::printf("expected\n%sfirst\n%ssecond\n%s", want.c_str(),
+                first->log.c_str(), second->log.c_str());
+  log = first->log;
+  return ok;
+}
+
+int main() {
+  SystemAccess::setValidation(true);
+  JobSystem jobs(2);
+  bool ok = true;
+  for (JobSystem *pool : {static_cast<JobSystem *>(nullptr), &jobs}) {
+    std::string sparse, archetype;
+    ok = run(StorageMode::SparseSet, "sparse", pool, sparse) && ok;
+    ok = run(StorageMode::Archetype, "archetype", pool, archetype) && ok;
+    bool same = sparse == archetype;
+    std::printf("storage modes agree: %s\n", same ? "ok" : "FAILED");
+    ok = ok && same;
+  }
+  return ok ? 0 : 1;
+}
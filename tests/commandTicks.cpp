@@ -0,0 +1,71 @@
+// Entities a system spawns through World::commands() show up exactly once in
+// the Added<> views of later frames, both for the spawning system and for a
+// system sharing its wave.
+//
+//   make tests
+#include <engine/core/jobSystem.hpp>
+#include <engine/core/world.hpp>
+#include <engine/ecs/commandBuffer.hpp>
+
+#include <cstdio>
+#include <memory>
+
+using namespace engine;
+
+struct Marker {
+  int value = 0;
+};
+
+// Counts the Markers added since its previous run
+class Watcher : public System {
+public:
+  void start(World &) override {}
+  void update(World &world, float) override {
+    world.view<Added<const Marker>>().each(
+        [this](const Marker &) { ++seen; });
+  }
+  void declareAccess(SystemAccess &access) override { access.read<Marker>(); }
+
+  int seen = 0;
+};
+
+// Spawns one marked entity in its first update
+class Spawner : public Watcher {
+public:
+  void update(World &world, float dt) override {
+    Watcher::update(world, dt);
+    if (spawned)
+      return;
+    CommandBuffer &commands = world.commands();
+    commands.addComponent(commands.createEntity(), Marker{1});
+    spawned = true;
+  }
+
+  bool spawned = false;
+};
+
+static bool run(const char *name, JobSystem *jobs) {
+  EngineContext context;
+  context.jobs = jobs;
+  World world;
+  world.setContext(&context);
+  auto spawner = std::make_shared<Spawner>();
+  auto watcher = std::make_shared<Watcher>();
+  world.addSystem(spawner);
+  world.addSystem(watcher);
+
+  for (int frame = 0; frame < 4; ++frame)
+    world.updateSystems(0.f);
+
+  bool ok = spawner->seen == 1 && watcher->seen == 1;
+  std::printf("%-8s spawner saw %d, watcher saw %d: %s\n", name,
+              spawner->seen, watcher->seen, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main() {
+  JobSystem jobs(2);
+  bool ok = run("serial", nullptr);
+  ok = run("jobs", &jobs) && ok;
+  return ok ? 0 : 1;
+}
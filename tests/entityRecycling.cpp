@@ -0,0 +1,53 @@
+// Handles of destroyed entities stay dead however often their slot is
+// recycled, and a requested id never takes a slot a command buffer reserved.
+//
+//   make tests
+#include <engine/ecs/entity.hpp>
+
+#include <cstdio>
+
+using namespace engine;
+
+// Spawns and destroys one entity until the first slot has gone through more
+// generations than a handle holds
+static bool staleHandles() {
+  EntityRegistry registry;
+  Entity first = registry.create();
+  registry.destroy(first);
+
+  const std::size_t cycles =
+      (EntityGenerationMask + 2) * (EntityRegistry::MinFreeSlots + 1);
+  std::size_t reused = 0;
+  bool ok = true;
+  for (std::size_t i = 0; i < cycles && ok; ++i) {
+    Entity e = registry.create();
+    reused += entityIndex(e) == entityIndex(first);
+    ok = e != first && !registry.alive(first);
+    registry.destroy(e);
+  }
+  // the slot went through every generation, then was retired
+  ok = ok && reused == EntityGenerationMask;
+  std::printf("%zu cycles, first slot reused %zu times, stale handle dead: "
+              "%s\n",
+              cycles, reused, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+static bool reservedSlots() {
+  EntityRegistry registry;
+  Entity reserved = registry.reserve();
+  Entity loaded = registry.create(reserved);
+  registry.materialize(reserved);
+
+  bool ok = loaded == NullEntity && registry.alive(reserved) &&
+            registry.getEntities().size() == 1;
+  std::printf("requested id of a reserved slot refused: %s\n",
+              ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main() {
+  bool ok = staleHandles();
+  ok = reservedSlots() && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+// HierarchySystem gives bit-identical GlobalTransforms with root subtrees
+// updated in parallel on a JobSystem and serially without one, including
+// after re-parenting and after destroyed entities are compacted away.
+//
+//   make tests
+#include <engine/components/components.hpp>
+#include <engine/core/jobSystem.hpp>
+#include <engine/core/world.hpp>
+#include <engine/systems/systems.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace engine;
+
+// Same random forest and edits in every instance, so entity handles match
+struct Scene {
+  explicit Scene(JobSystem *jobs) {
+    context.jobs = jobs;
+    world.setContext(&context);
+    world.addSystem(std::make_shared<HierarchySystem>());
+    for (int i = 0; i < 20000; ++i)
+      spawn();
+  }
+
+  void spawn() {
+    Entity e = world.createEntity();
+    TransformComponent transform;
+    transform.position = Vec3(value(rng), value(rng), value(rng));
+    transform.setEuler(Vec3(value(rng), value(rng), value(rng)));
+    transform.scale = Vec3(1 + value(rng) * 0.1f, 1, 1);
+    world.addComponent(e, transform);
+    // mostly shallow trees of a few hundred roots
+    if (!entities.empty() && rng() % 50 != 0) {
+      Entity parent = entities[rng() % entities.size()];
+      world.setParent(e, parent);
+    }
+    entities.push_back(e);
+  }
+
+  void moveSome() {
+    for (int i = 0; i < 2000; ++i)
+      world.getComponent<TransformComponent>(entities[rng() % entities.size()])
+          .position.x += 0.01f;
+  }
+
+  void reparent() {
+    for (int i = 0; i < 500; ++i) {
+      Entity e = entities[rng() % entities.size()];
+      Entity parent = entities[rng() % entities.size()];
+      if (rng() % 5 == 0)
+        world.removeParent(e);
+      else if (!world.getHierarchy().inSubtree(parent, e))
+        world.setParent(e, parent);
+    }
+  }
+
+  void destroySome() {
+    for (int i = 0; i < 500; ++i) {
+      std::size_t at = rng() % entities.size();
+      world.destroyEntity(entities[at]);
+      entities[at] = entities.back();
+      entities.pop_back();
+    }
+    for (int i = 0; i < 300; ++i)
+      spawn();
+  }
+
+  EngineContext context;
+  World world;
+  std::vector<Entity> entities;
+  std::mt19937 rng{11};
+  std::uniform_real_distribution<float> value{-1.f, 1.f};
+};
+
+static bool same(Scene &serial, Scene &parallel) {
+  if (serial.entities != parallel.entities)
+    return false;
+  for (Entity e : serial.entities) {
+    const Mat4 &a =
+        serial.world.getComponent<const GlobalTransform>(e).worldMatrix;
+    const Mat4 &b =
+        parallel.world.getComponent<const GlobalTransform>(e).worldMatrix;
+    if (std::memcmp(&a, &b, sizeof(Mat4)) != 0)
+      return false;
+  }
+  return true;
+}
+
+int main() {
+  JobSystem jobs(4);
+  Scene serial(nullptr);
+  Scene parallel(&jobs);
+
+  bool ok = true;
+  auto frame = [&](const char *name, void (Scene::*edit)()) {
+    if (edit) {
+      (serial.*edit)();
+      (parallel.*edit)();
+    }
+    serial.world.updateSystems(0.f);
+    parallel.world.updateSystems(0.f);
+    bool match = same(serial, parallel);
+    std::printf("%-12s serial and %u threads match: %s\n", name,
+                jobs.threadCount(), match ? "ok" : "FAILED");
+    ok = ok && match;
+  };
+
+  frame("spawned", nullptr);
+  frame("moved", &Scene::moveSome);
+  frame("re-parented", &Scene::reparent);
+  frame("destroyed", &Scene::destroySome);
+  frame("moved", &Scene::moveSome);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+// The software rasterizer draws the same image whichever way the pixels are
+// produced: tiles on the calling thread or on the job system, forward or
+// visibility buffer shading, and the raster/shade variants built for each
+// material feature set or the generic one that checks features per pixel.
+// The scenes cover every feature combination, a draw with more triangles
+// than a visibility buffer id holds and more draws than it can tell apart.
+// Uses SDL's dummy video driver, nothing is shown.
+//
+//   make tests
+#include <engine/core/jobSystem.hpp>
+#include <engine/renderer/renderer.hpp>
+
+#include <SDL2/SDL.h>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace engine;
+
+static const int Width = 320, Height = 240;
+
+struct Item {
+  std::shared_ptr<Mesh> mesh;
+  GlobalTransform global;
+  MaterialComponent material;
+};
+
+static Mat4 placed(Vec3 position, Vec3 euler = Vec3(0)) {
+  TransformComponent transform;
+  transform.position = position;
+  transform.setEuler(euler);
+  return Mat4::modelMatrix(transform);
+}
+
+// Spheres in every combination of the material features, overlapping each
+// other and a floor, the ones without depth test drawn last
+static std::vector<Item> materials(std::shared_ptr<Texture> texture) {
+  auto sphere = Mesh::createSphere(0.9f, 24, 24);
+  for (std::size_t i = 0; i < sphere->vertices.size(); ++i) {
+    const Vec3 &v = sphere->vertices[i];
+    sphere->textureMap[i] = Vec3(v.x * 0.5f + 0.5f, v.y * 0.5f + 0.5f, 0);
+  }
+  for (Triangle &tri : sphere->triangles) {
+    tri.uv0 = tri.i0;
+    tri.uv1 = tri.i1;
+    tri.uv2 = tri.i2;
+  }
+
+  std::vector<Item> items;
+  items.push_back({Mesh::createBox(20, 0.2f, 20),
+                   placed(Vec3(0, -2.2f, 0)), MaterialComponent{}});
+  for (int features = 0; features < 16; ++features) {
+    MaterialComponent material;
+    material.baseColor = Vec3(0.2f + 0.05f * features, 0.5f, 0.9f - 0.05f * features);
+    material.texture = texture;
+    material.useTexture = features & 1;
+    material.specular = features & 2 ? 0.7f : 0.0f;
+    material.smoothShading = features & 4;
+    material.depthTest = !(features & 8);
+    float x = (features % 4) * 1.5f - 2.25f;
+    float y = (features / 4) * 1.2f - 1.8f;
+    items.push_back({sphere, placed(Vec3(x, y, features * 0.1f), Vec3(0.3f, 0.2f * features, 0)),
+                     material});
+  }
+  return items;
+}
+
+// A grid of about 1.1M triangles filling the screen, more than one draw can
+// give visibility buffer ids to, then more boxes than there are draw ids
+static std::vector<Item> ids() {
+  auto grid = std::make_shared<Mesh>();
+  const int quads = 740;
+  for (int y = 0; y <= quads; ++y)
+    for (int x = 0; x <= quads; ++x)
+      grid->vertices.push_back(
+          Vec3(x * 12.0f / quads - 6, y * 12.0f / quads - 6, 0));
+  for (int y = 0; y < quads; ++y) {
+    for (int x = 0; x < quads; ++x) {
+      int i = y * (quads + 1) + x;
+      grid->triangles.push_back({i, i + quads + 1, i + 1});
+      grid->triangles.push_back({i + 1, i + quads + 1, i + quads + 2});
+    }
+  }
+  grid->textureMap.assign(grid->vertices.size(), Vec3(0));
+  grid->updateSoA();
+  grid->updateBounds();
+
+  std::vector<Item> items;
+  MaterialComponent gridMaterial;
+  gridMaterial.specular = 0;
+  items.push_back({grid, placed(Vec3(0, 0, 2), Vec3(0.2f, 0.1f, 0)), gridMaterial});
+
+  auto box = Mesh::createBox(0.08f, 0.08f, 0.08f);
+  for (int i = 0; i < 5000; ++i) {
+    MaterialComponent material;
+    material.baseColor = Vec3((i % 7) / 7.0f, (i % 11) / 11.0f, (i % 13) / 13.0f);
+    items.push_back({box,
+                     placed(Vec3((i % 100) * 0.08f - 4, (i / 100) * 0.12f - 3,
+                                 (i % 3) * 0.05f),
+                            Vec3(0.5f, 0.7f, 0)),
+                     material});
+  }
+  return items;
+}
+
+struct Config {
+  const char *name;
+  ShadingMode mode;
+  bool specialized;
+  bool jobs;
+};
+
+static std::vector<uint32_t> render(Renderer &renderer,
+                                    const std::vector<Item> &items,
+                                    const Config &config, JobSystem &jobs) {
+  TransformComponent cameraTransform;
+  cameraTransform.position = Vec3(0, 0, -5);
+  CameraComponent camera{1.3f, float(Width) / Height, 1.0f, 40.f};
+  RenderView view =
+      renderer.prepareView(Mat4::modelMatrix(cameraTransform), camera);
+
+  renderer.setShadingMode(config.mode);
+  renderer.setSpecializedPipelines(config.specialized);
+  renderer.clear();
+  for (const Item &item : items)
+    renderer.renderMesh(item.mesh.get(), item.global, view, item.material);
+  renderer.flush(config.jobs ? &jobs : nullptr);
+
+  const uint32_t *pixels = renderer.getFramebuffer();
+  return std::vector<uint32_t>(pixels, pixels + Width * Height);
+}
+
+static bool compare(const char *scene, Renderer &renderer,
+                    const std::vector<Item> &items, JobSystem &jobs) {
+  static const Config configs[] = {
+      {"forward serial", ShadingMode::Forward, true, false},
+      {"forward jobs", ShadingMode::Forward, true, true},
+      {"visibility serial", ShadingMode::Visibility, true, false},
+      {"visibility jobs", ShadingMode::Visibility, true, true},
+      {"generic forward", ShadingMode::Forward, false, false},
+      {"generic visibility", ShadingMode::Visibility, false, true},
+  };
+
+  std::vector<uint32_t> reference = render(renderer, items, configs[0], jobs);
+  // an image left mostly at the clear color would compare equal too easily
+  uint32_t sky = reference[0];
+  std::size_t drawn = 0;
+  for (uint32_t pixel : reference)
+    drawn += pixel != sky;
+  bool ok = drawn > reference.size() / 2;
+  std::printf("%-9s %-18s %5.1f%% drawn: %s\n", scene, configs[0].name,
+              100.0 * drawn / reference.size(), ok ? "ok" : "FAILED");
+
+  for (std::size_t c = 1; c < sizeof(configs) / sizeof(configs[0]); ++c) {
+    std::vector<uint32_t> image = render(renderer, items, configs[c], jobs);
+    std::size_t differ = 0;
+    for (std::size_t i = 0; i < image.size(); ++i)
+      differ += image[i] != reference[i];
+    std::printf("%-9s %-18s %6zu pixels differ: %s\n", scene, configs[c].name,
+                differ, differ == 0 ? "ok" : "FAILED");
+    ok = ok && differ == 0;
+  }
+  return ok;
+}
+
+// A triangle with a NaN corner is counted and dropped instead of drawn
+static bool nonFinite(Renderer &renderer) {
+  auto mesh = std::make_shared<Mesh>();
+  mesh->vertices = {Vec3(-1, -1, 0), Vec3(NAN, 1, 0), Vec3(1, -1, 0)};
+  mesh->triangles.push_back({0, 1, 2});
+  mesh->textureMap.assign(3, Vec3(0));
+  mesh->updateSoA();
+  mesh->updateBounds();
+
+  JobSystem jobs(1);
+  std::vector<uint32_t> image = render(
+      renderer, {{mesh, placed(Vec3(0)), MaterialComponent{}}},
+      {"nan", ShadingMode::Forward, true, false}, jobs);
+  uint32_t sky = image[0];
+  std::size_t drawn = 0;
+  for (uint32_t pixel : image)
+    drawn += pixel != sky;
+  bool ok = renderer.getDroppedTriangles() == 1 && drawn == 0;
+  std::printf("non-finite corner: %zu dropped, %zu pixels drawn: %s\n",
+              renderer.getDroppedTriangles(), drawn, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main() {
+  SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+  SDL_Init(SDL_INIT_VIDEO);
+  bool ok = true;
+  {
+    Renderer renderer(Width, Height, "rasterModes");
+    JobSystem jobs(4);
+
+    // 4x4 checker
+    static Uint32 texels[16];
+    for (int i = 0; i < 16; ++i)
+      texels[i] = (i + i / 4) % 2 ? 0xFFE04020 : 0xFF20A0E0;
+    auto texture = std::make_shared<Texture>();
+    texture->texturePixels = texels;
+    texture->texWidth = 4;
+    texture->texHeight = 4;
+
+    ok = compare("materials", renderer, materials(texture), jobs) && ok;
+    ok = compare("ids", renderer, ids(), jobs) && ok;
+    ok = nonFinite(renderer) && ok;
+  }
+  SDL_Quit();
+  return ok ? 0 : 1;
+}
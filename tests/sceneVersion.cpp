@@ -0,0 +1,64 @@
+// A camera in a scene saved before the "version" field still looks where it
+// did, and scenes saved now load back unchanged.
+//
+//   make tests
+#include <engine/components/components.hpp>
+#include <engine/core/world.hpp>
+#include <engine/math/mat4.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+using namespace engine;
+
+static const char *Path = "build/tests/sceneVersion.json";
+
+static Vec3 forwardOf(World &world, Entity camera) {
+  Mat4 m = Mat4::modelMatrix(world.getComponent<const TransformComponent>(camera));
+  Vec4 f = m * Vec4(0, 0, 1, 0);
+  return Vec3(f.x, f.y, f.z);
+}
+
+static bool near(const Vec3 &a, const Vec3 &b) {
+  return std::fabs(a.x - b.x) < 1e-4f && std::fabs(a.y - b.y) < 1e-4f &&
+         std::fabs(a.z - b.z) < 1e-4f;
+}
+
+int main() {
+  const float pitch = 0.3f, yaw = 0.5f;
+  {
+    std::ofstream out(Path);
+    out << R"({"activeCamera": 1, "entities": [{"id": 1, "components": {
+      "TransformComponent": {"position": {"x": 0, "y": 0, "z": 0},
+                             "rotation": {"x": 0.3, "y": 0.5, "z": 0},
+                             "scale": {"x": 1, "y": 1, "z": 1}},
+      "CameraComponent": {"fov": 1.5, "aspectRatio": 1.7, "nearPlane": 1,
+                          "farPlane": 30}}}]})";
+  }
+
+  World world;
+  world.registerDefaults();
+  world.loadScene(Path);
+  Entity camera = world.getCamera();
+
+  // the direction version 1 views looked in
+  Vec3 expected(std::cos(pitch) * std::sin(yaw), std::sin(pitch),
+                std::cos(pitch) * std::cos(yaw));
+  Vec3 old = forwardOf(world, camera);
+  bool ok = near(old, expected);
+  std::printf("version 1 camera forward (%.3f %.3f %.3f): %s\n", old.x, old.y,
+              old.z, ok ? "ok" : "FAILED");
+
+  world.saveScene(Path);
+  World reloaded;
+  reloaded.registerDefaults();
+  reloaded.loadScene(Path);
+  Vec3 now = forwardOf(reloaded, reloaded.getCamera());
+  bool roundTrip = near(now, old);
+  std::printf("version 2 round trip (%.3f %.3f %.3f): %s\n", now.x, now.y,
+              now.z, roundTrip ? "ok" : "FAILED");
+
+  std::remove(Path);
+  return ok && roundTrip ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+// Scripts can add components, re-parent and destroy entities directly from
+// start() and update(), ScriptSystem doesn't run them under a live view.
+//
+//   make tests
+#include <engine/components/components.hpp>
+#include <engine/core/world.hpp>
+#include <engine/script/script.hpp>
+#include <engine/systems/systems.hpp>
+
+#include <cstdio>
+#include <exception>
+#include <memory>
+
+using namespace engine;
+
+struct Marker {
+  int value = 0;
+};
+
+// Marks its entity in start(), spawns a child in its first update and
+// destroys that child in the next
+class Spawner : public Script {
+public:
+  Spawner() : Script("Spawner") {}
+
+  void start() override { world->addComponent(entityId, Marker{1}); }
+
+  void update(float) override {
+    if (child == NullEntity) {
+      child = world->createEntity();
+      world->addComponent(child, TransformComponent{});
+      world->setParent(child, entityId);
+    } else if (world->isAlive(child)) {
+      world->destroyEntity(child);
+    }
+  }
+
+  Entity child = NullEntity;
+};
+
+static bool run(const char *name, StorageMode mode) {
+  World world(mode);
+  world.addSystem(std::make_shared<ScriptSystem>());
+  Entity e = world.createEntity();
+  auto script = std::make_shared<Spawner>();
+  world.addScript(e, script);
+
+  bool ok = true;
+  try {
+    world.startSystems();
+    for (int frame = 0; frame < 2; ++frame)
+      world.updateSystems(0.f);
+  } catch (const std::exception &error) {
+    std::printf("%-9s threw: %s\n", name, error.what());
+    ok = false;
+  }
+
+  ok = ok && world.hasComponent<Marker>(e) && script->child != NullEntity &&
+       !world.isAlive(script->child) && world.getChildren(e).empty();
+  std::printf("%-9s script structural changes: %s\n", name,
+              ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main() {
+  bool ok = run("sparse", StorageMode::SparseSet);
+  ok = run("archetype", StorageMode::Archetype) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+// World calls that change both components and the transform hierarchy throw
+// under a live view before changing either, so the world stays consistent.
+//
+//   make tests
+#include <engine/components/components.hpp>
+#include <engine/core/world.hpp>
+
+#include <cstdio>
+#include <stdexcept>
+
+using namespace engine;
+
+// True if func threw std::logic_error
+template <typename Func> static bool throws(Func &&func) {
+  try {
+    func();
+  } catch (const std::logic_error &) {
+    return true;
+  }
+  return false;
+}
+
+static bool run(const char *name, StorageMode mode) {
+  World world(mode);
+  Entity parent = world.createEntity();
+  Entity child = world.createEntity();
+  world.addComponent(parent, TransformComponent{});
+  world.addComponent(child, TransformComponent{});
+  world.setParent(child, parent);
+
+  // other has no ChildrenComponent yet, so setParent has to add one
+  Entity other = world.createEntity();
+  world.addComponent(other, TransformComponent{});
+
+  bool ok = true;
+  {
+    auto view = world.view<const TransformComponent>();
+    view.begin(); // locks until view is destroyed
+    ok = throws([&] { world.destroyEntity(parent); }) && ok;
+    ok = throws([&] { world.setParent(child, other); }) && ok;
+    ok = throws([&] { world.removeParent(child); }) && ok;
+  }
+
+  TransformHierarchy &hierarchy = world.getHierarchy();
+  ok = ok && world.isAlive(parent) && hierarchy.contains(parent) &&
+       hierarchy.entityAt(hierarchy.parentOf(hierarchy.indexOf(child))) ==
+           parent &&
+       world.getComponent<const ParentComponent>(child).parent == parent &&
+       world.getChildren(parent).size() == 1 &&
+       world.getChildren(other).empty();
+
+  // applies once the view is gone
+  world.destroyEntity(parent);
+  ok = ok && !world.isAlive(parent) && !world.hasComponent<ParentComponent>(child);
+
+  std::printf("%-9s hierarchy intact after a locked change: %s\n", name,
+              ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main() {
+  bool ok = run("sparse", StorageMode::SparseSet);
+  ok = run("archetype", StorageMode::Archetype) && ok;
+  return ok ? 0 : 1;
+}
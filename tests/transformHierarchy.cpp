@@ -0,0 +1,132 @@
+// After random re-parenting, detaching and destroying, HierarchySystem keeps
+// the nodes parents first with contiguous subtrees, and every
+// GlobalTransform equals its parent's times its own local matrix. Removing
+// a TransformComponent drops the entity from the hierarchy.
+//
+//   make tests
+#include <engine/components/components.hpp>
+#include <engine/core/world.hpp>
+#include <engine/systems/systems.hpp>
+
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace engine;
+
+// World matrix the slow way, through the ParentComponent links
+static Mat4 expectedWorld(World &world, Entity e) {
+  Mat4 local =
+      Mat4::modelMatrix(world.getComponent<const TransformComponent>(e));
+  if (!world.hasComponent<ParentComponent>(e))
+    return local;
+  return expectedWorld(world,
+                       world.getComponent<const ParentComponent>(e).parent) *
+         local;
+}
+
+static bool check(World &world, const std::vector<Entity> &alive) {
+  TransformHierarchy &hierarchy = world.getHierarchy();
+  for (uint32_t i = 0; i < hierarchy.size(); ++i) {
+    uint32_t parent = hierarchy.parentOf(i);
+    if (hierarchy.entityAt(i) == NullEntity)
+      return false;
+    if (parent != TransformHierarchy::None &&
+        (parent >= i || i >= parent + hierarchy.subtreeSize(parent)))
+      return false;
+  }
+  for (Entity e : alive) {
+    Mat4 expected = expectedWorld(world, e);
+    const Mat4 &actual = world.getComponent<const GlobalTransform>(e).worldMatrix;
+    if (std::memcmp(&expected, &actual, sizeof(Mat4)) != 0)
+      return false;
+  }
+  return hierarchy.size() == alive.size();
+}
+
+static bool removedTransform() {
+  World world;
+  world.addSystem(std::make_shared<HierarchySystem>());
+  Entity parent = world.createEntity();
+  Entity child = world.createEntity();
+  TransformComponent moved;
+  moved.position = Vec3(1, 2, 3);
+  world.addComponent(parent, moved);
+  world.addComponent(child, moved);
+  world.setParent(child, parent);
+  world.updateSystems(0.f);
+
+  world.removeComponent<TransformComponent>(parent);
+  Mat4 untouched = Mat4::identity();
+  world.getComponent<GlobalTransform>(parent).set(untouched);
+  world.getComponent<TransformComponent>(child).position.x += 1;
+  world.updateSystems(0.f);
+
+  Mat4 local = Mat4::modelMatrix(world.getComponent<const TransformComponent>(child));
+  bool ok =
+      !world.getHierarchy().contains(parent) &&
+      std::memcmp(&world.getComponent<const GlobalTransform>(child).worldMatrix,
+                  &local, sizeof(Mat4)) == 0 &&
+      std::memcmp(&world.getComponent<const GlobalTransform>(parent).worldMatrix,
+                  &untouched, sizeof(Mat4)) == 0;
+  std::printf("removed TransformComponent leaves the hierarchy: %s\n",
+              ok ? "ok" : "FAILED");
+  return ok;
+}
+
+static bool randomEdits() {
+  World world;
+  world.addSystem(std::make_shared<HierarchySystem>());
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> value(-1.f, 1.f);
+
+  std::vector<Entity> alive;
+  auto spawn = [&] {
+    Entity e = world.createEntity();
+    TransformComponent transform;
+    transform.position = Vec3(value(rng), value(rng), value(rng));
+    transform.setEuler(Vec3(value(rng), value(rng), value(rng)));
+    world.addComponent(e, transform);
+    world.addComponent(e, GlobalTransform{});
+    alive.push_back(e);
+  };
+  for (int i = 0; i < 500; ++i)
+    spawn();
+
+  bool ok = true;
+  for (int frame = 0; frame < 50 && ok; ++frame) {
+    for (int op = 0; op < 40; ++op) {
+      Entity e = alive[rng() % alive.size()];
+      switch (rng() % 4) {
+      case 0:
+      case 1: {
+        Entity parent = alive[rng() % alive.size()];
+        if (!world.getHierarchy().inSubtree(parent, e))
+          world.setParent(e, parent);
+        break;
+      }
+      case 2:
+        world.removeParent(e);
+        break;
+      default:
+        world.destroyEntity(e);
+        alive.erase(std::find(alive.begin(), alive.end(), e));
+        spawn();
+      }
+    }
+    world.updateSystems(0.f);
+    ok = check(world, alive);
+  }
+
+  std::printf("flat hierarchy after random edits: %s\n", ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main() {
+  bool ok = randomEdits();
+  ok = removedTransform() && ok;
+  return ok ? 0 : 1;
+}
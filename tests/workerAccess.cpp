@@ -0,0 +1,87 @@
+// A declared system's parEach ranges are validated against its declaration
+// and see its change tick on whichever thread runs them: undeclared reads
+// throw on workers too, declared ones don't.
+//
+//   make tests
+#include <engine/core/jobSystem.hpp>
+#include <engine/core/world.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+
+using namespace engine;
+
+struct Position {
+  float x = 0;
+};
+struct Velocity {
+  float x = 0;
+};
+
+// Reads Position, then tries Velocity, which it didn't declare, from every
+// entity of a parEach
+class Reader : public System {
+public:
+  void start(World &) override {}
+  void update(World &world, float) override {
+    uint32_t lastRun = ChangeTicks::lastRun;
+    world.view<const Position>().parEach([&](Entity e, const Position &) {
+      // long enough that the workers take part
+      volatile float sink = 0;
+      for (int i = 0; i < 2000; ++i)
+        sink = sink + world.getComponent<const Position>(e).x;
+
+      onWorkers += JobSystem::threadIndex() != 0;
+      wrongTick += ChangeTicks::lastRun != lastRun;
+      try {
+        world.getComponent<const Velocity>(e);
+      } catch (const std::runtime_error &) {
+        ++refused;
+      }
+    });
+  }
+  void declareAccess(SystemAccess &access) override {
+    access.read<Position>();
+  }
+
+  std::atomic<int> onWorkers{0}, wrongTick{0}, refused{0};
+};
+
+static bool run(StorageMode mode, const char *name, JobSystem &jobs) {
+  EngineContext context;
+  context.jobs = &jobs;
+  World world(mode);
+  world.setContext(&context);
+  auto reader = std::make_shared<Reader>();
+  world.addSystem(reader);
+
+  const int count = 20000;
+  for (int i = 0; i < count; ++i) {
+    Entity e = world.createEntity();
+    world.addComponent(e, Position{float(i)});
+    world.addComponent(e, Velocity{});
+  }
+  // the first frame's lastRun is 0, the second one's isn't
+  world.updateSystems(0.f);
+  reader->refused = 0;
+  world.updateSystems(0.f);
+
+  bool ok = reader->onWorkers > 0 && reader->refused == count &&
+            reader->wrongTick == 0;
+  std::printf("%-9s %d of %d on workers, %d undeclared reads refused, %d "
+              "wrong ticks: %s\n",
+              name, reader->onWorkers.load(), 2 * count,
+              reader->refused.load(), reader->wrongTick.load(),
+              ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main() {
+  SystemAccess::setValidation(true);
+  JobSystem jobs(3);
+  bool ok = run(StorageMode::SparseSet, "sparse", jobs);
+  ok = run(StorageMode::Archetype, "archetype", jobs) && ok;
+  return ok ? 0 : 1;
+}